@@ -0,0 +1,25 @@
+//Counts heap allocations made by the current thread, to check that steady-state emulation never allocates.
+//Linking src/AllocationCounter.cpp replaces the global operator new with one that bumps a thread-local
+//counter, so it belongs in executables only, never in the core library or chip8env.
+
+#pragma once
+
+namespace Chip8 {
+
+	class AllocationCounter {
+
+	private:
+		unsigned long long _start;
+
+	public:
+		//Starts counting from now
+		AllocationCounter();
+
+		//Allocations by this thread since construction
+		unsigned long long allocations() const;
+
+		//Allocations by this thread since it started
+		static unsigned long long total();
+
+	};
+};
@@ -0,0 +1,114 @@
+//Differential co-simulation: two execution engines run the same ROM and key log in lockstep, and their
+//architectural state is compared every N instructions. On a mismatch, the run is replayed from the last
+//matching checkpoint and bisected down to the first instruction whose result differs.
+
+#pragma once
+
+#include "Machine.h"
+#include <array>
+#include <string>
+#include <vector>
+
+namespace Chip8 {
+
+	//Advances a machine by exactly the given number of instructions; timers and keys are the caller's
+	class Engine {
+
+	public:
+		virtual ~Engine() = default;
+
+		virtual const char* name() const = 0;
+		virtual void run(Machine& machine, unsigned int cycles) const = 0;
+	};
+
+	//The simple interpreter, one emulateCycle per instruction
+	class ReferenceEngine : public Engine {
+
+	public:
+		const char* name() const override { return "reference"; }
+		void run(Machine& machine, unsigned int cycles) const override;
+	};
+
+	//runCycles with idle-loop skipping, as used by headless and turbo runs
+	class IdleSkipEngine : public Engine {
+
+	public:
+		const char* name() const override { return "idle-skip"; }
+		void run(Machine& machine, unsigned int cycles) const override;
+	};
+
+	//Core::step over the machine's state: the constexpr core's copy of the opcode semantics
+	class CoreEngine : public Engine {
+
+	public:
+		const char* name() const override { return "core"; }
+		void run(Machine& machine, unsigned int cycles) const override;
+	};
+
+	//Everything the comparison looks at
+	struct MachineState
+	{
+		std::array<unsigned char, 16> registers;
+		unsigned short index;
+		unsigned short programCounter;
+		unsigned short stackPointer;
+		std::array<unsigned short, 16> stack;
+		unsigned char delayTimer;
+		unsigned char soundTimer;
+		unsigned long long cycles;
+		unsigned long long memoryHash;
+		unsigned long long framebufferHash;
+
+		static MachineState of(const Machine& machine);
+
+		bool operator==(const MachineState& other) const;
+		bool operator!=(const MachineState& other) const { return !(*this == other); }
+
+		//One-line dump; fields listed in highlight are marked with '*'
+		std::string describe(const MachineState* highlight = nullptr) const;
+	};
+
+	struct Divergence
+	{
+		unsigned long long instruction;		//Instructions both engines ran identically
+		unsigned short programCounter;		//Address and opcode of the first one that differs
+		unsigned short opcode;
+		bool frameBoundary;					//That instruction ends a frame, so timers and keys ran after it
+		bool chunkDependent;				//Single-stepping it agrees: the candidate depends on how runs are split
+		MachineState before;
+		MachineState reference;
+		MachineState candidate;
+
+		std::string report(const Engine& reference, const Engine& candidate) const;
+	};
+
+	class CoSimulator {
+
+	private:
+		const Engine& _candidate;
+		unsigned long long _checks;
+		unsigned int _cyclesPerFrame;
+		unsigned int _interval;
+		std::vector<std::pair<unsigned long long, unsigned short>> _keys;
+		const Engine& _reference;
+
+		//Runs instructions [from, to) of the schedule: at every frame boundary the timers tick,
+		//then the key mask for the new frame is applied
+		void advance(Machine& machine, const Engine& engine, unsigned long long from, unsigned long long to) const;
+		unsigned short keysAt(unsigned long long frame) const;
+		Divergence bisect(Machine reference, Machine candidate, unsigned long long from, unsigned long long to) const;
+
+	public:
+		CoSimulator(const Engine& reference, const Engine& candidate, unsigned int interval = 1000, unsigned int cyclesPerFrame = 540 / 60);
+
+		//Key mask held from the given frame on (all keys up before the first entry)
+		void setKeys(unsigned long long frame, unsigned short mask);
+
+		//Runs both engines from copies of start. Returns true if they agreed at every check;
+		//otherwise divergence describes the first differing instruction.
+		bool run(const Machine& start, unsigned long long instructions, Divergence& divergence);
+
+		unsigned long long checks() const { return _checks; }
+
+	};
+};
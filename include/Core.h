@@ -0,0 +1,297 @@
+//constexpr CHIP-8 core: the opcode semantics over a plain state struct, usable at compile time.
+//Small ROMs and single opcodes can be run inside static_assert, and the tables the interpreter needs
+//(font set, BCD digits, sprite row bits) are generated by the compiler.
+//Machine shares these tables and helpers but keeps its own opcode handlers, with copy-on-write memory,
+//idle skipping and tool hooks around them. The two copies are kept in step by CoreEngine: ctest runs
+//`Chip8CoSim --engine core` over the test ROMs, comparing step() against Machine::emulateCycle.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+namespace Chip8 {
+	namespace Core {
+
+		inline constexpr std::array<unsigned char, 80> Fontset =
+		{
+		  0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+		  0x20, 0x60, 0x20, 0x20, 0x70, // 1
+		  0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+		  0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+		  0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+		  0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+		  0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+		  0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+		  0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+		  0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+		  0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+		  0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+		  0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+		  0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+		  0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+		  0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+		};
+
+		//Fx29: the font set lives at 0x000, five bytes per glyph
+		constexpr unsigned short fontAddress(unsigned char digit)
+		{
+			return static_cast<unsigned short>(digit * 0x5);
+		}
+
+		//Fx33 digits for every byte value, hundreds first
+		constexpr std::array<std::array<unsigned char, 3>, 256> makeBcdTable()
+		{
+			std::array<std::array<unsigned char, 3>, 256> table = {};
+			for (unsigned int value = 0; value < 256; value++)
+			{
+				table[value][0] = static_cast<unsigned char>(value / 100);
+				table[value][1] = static_cast<unsigned char>((value / 10) % 10);
+				table[value][2] = static_cast<unsigned char>(value % 10);
+			}
+			return table;
+		}
+		inline constexpr auto BcdTable = makeBcdTable();
+
+		//Dxyn: the 8 pixels of a sprite byte, leftmost first, as 0/1 to XOR straight into gfx
+		constexpr std::array<std::array<unsigned char, 8>, 256> makeSpriteBits()
+		{
+			std::array<std::array<unsigned char, 8>, 256> table = {};
+			for (unsigned int value = 0; value < 256; value++)
+			{
+				for (unsigned int bit = 0; bit < 8; bit++)
+				{
+					table[value][bit] = static_cast<unsigned char>((value >> (7 - bit)) & 1);
+				}
+			}
+			return table;
+		}
+		inline constexpr auto SpriteBits = makeSpriteBits();
+
+		//8xy4 / 8xy5 / 8xy7 flags, from the operands before the write
+		constexpr unsigned char carry(unsigned char x, unsigned char y)
+		{
+			return y > 0xFF - x ? 1 : 0;
+		}
+
+		constexpr unsigned char noBorrow(unsigned char minuend, unsigned char subtrahend)
+		{
+			return subtrahend > minuend ? 0 : 1;
+		}
+
+		//xorshift32 step for Cxkk; the byte is the new state % 0xFF
+		constexpr unsigned int nextRandom(unsigned int state)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+
+		struct State
+		{
+			std::array<unsigned char, 4096> memory = {};
+			std::array<unsigned char, 2048> gfx = {};
+			std::array<unsigned short, 16> stack = {};
+			std::array<unsigned char, 16> registers = {};
+			unsigned short keys = 0;
+			unsigned short index = 0;
+			unsigned short programCounter = 0x200;
+			unsigned short sp = 0;
+			unsigned char delayTimer = 0;
+			unsigned char soundTimer = 0;
+			unsigned int randomState = 0x2545F491;
+			unsigned long long cycles = 0;
+		};
+
+		//Fresh machine with the font set at 0x000 and the ROM at 0x200
+		template <size_t Size>
+		constexpr State boot(const std::array<unsigned char, Size>& rom)
+		{
+			static_assert(Size < 4096 - 512, "ROM too big for memory!");
+			State state;
+			for (size_t i = 0; i < Fontset.size(); i++)
+			{
+				state.memory[i] = Fontset[i];
+			}
+			for (size_t i = 0; i < Size; i++)
+			{
+				state.memory[0x200 + i] = rom[i];
+			}
+			return state;
+		}
+
+		//One instruction, with the same semantics (and the same order of register writes) as
+		//Machine::emulateCycle. Addresses wrap at 4K, the stack at 16 entries and key numbers at 16, as in Machine.
+		constexpr void step(State& s)
+		{
+			unsigned short opcode = static_cast<unsigned short>(s.memory[s.programCounter & 0xFFF] << 8 |
+				s.memory[(s.programCounter + 1) & 0xFFF]);
+			s.cycles++;
+
+			unsigned char x = (opcode & 0x0F00) >> 8;
+			unsigned char y = (opcode & 0x00F0) >> 4;
+			unsigned char kk = opcode & 0x00FF;
+			unsigned short nnn = opcode & 0x0FFF;
+			auto& vx = s.registers[x];
+			auto& vy = s.registers[y];
+			auto& vf = s.registers[0xF];
+
+			switch (opcode >> 12)
+			{
+			case 0x0:
+				if ((opcode & 0x000F) == 0x0)
+				{
+					for (auto& pixel : s.gfx)
+					{
+						pixel = 0;
+					}
+					s.programCounter += 2;
+				}
+				else if ((opcode & 0x000F) == 0xE)
+				{
+					s.sp--;
+					s.programCounter = static_cast<unsigned short>(s.stack[s.sp & 0xF] + 2);
+				}
+				break;
+			case 0x1: s.programCounter = nnn; break;
+			case 0x2:
+				s.stack[s.sp & 0xF] = s.programCounter;
+				s.sp++;
+				s.programCounter = nnn;
+				break;
+			case 0x3: s.programCounter += vx == kk ? 4 : 2; break;
+			case 0x4: s.programCounter += vx != kk ? 4 : 2; break;
+			case 0x5: s.programCounter += vx == vy ? 4 : 2; break;
+			case 0x6: vx = kk; s.programCounter += 2; break;
+			case 0x7: vx += kk; s.programCounter += 2; break;
+			case 0x8:
+				switch (opcode & 0x000F)
+				{
+				case 0x0: vx = vy; break;
+				case 0x1: vx |= vy; break;
+				case 0x2: vx &= vy; break;
+				case 0x3: vx ^= vy; break;
+				case 0x4: vf = carry(vx, vy); vx += vy; break;
+				case 0x5: vf = noBorrow(vx, vy); vx -= vy; break;
+				case 0x6: vf = vx & 0x1; vx >>= 1; break;
+				case 0x7: vf = noBorrow(vy, vx); vx = static_cast<unsigned char>(vy - vx); break;
+				case 0xE: vf = vx >> 7; vx <<= 1; break;
+				default: return;
+				}
+				s.programCounter += 2;
+				break;
+			case 0x9: s.programCounter += vx != vy ? 4 : 2; break;
+			case 0xA: s.index = nnn; s.programCounter += 2; break;
+			case 0xB: s.programCounter = static_cast<unsigned short>(nnn + s.registers[0]); break;
+			case 0xC:
+				s.randomState = nextRandom(s.randomState);
+				vx = static_cast<unsigned char>(s.randomState % 0xFF) & kk;
+				s.programCounter += 2;
+				break;
+			case 0xD:
+			{
+				unsigned short left = vx;
+				unsigned short top = vy;
+				vf = 0;
+				for (unsigned int row = 0; row < (opcode & 0x000F); row++)
+				{
+					auto& bits = SpriteBits[s.memory[(s.index + row) & 0xFFF]];
+					for (unsigned int column = 0; column < 8; column++)
+					{
+						auto point = (left + column + (top + row) * 64) % 2048;
+						vf |= s.gfx[point] & bits[column];
+						s.gfx[point] ^= bits[column];
+					}
+				}
+				s.programCounter += 2;
+				break;
+			}
+			case 0xE:
+				if (kk == 0x9E)
+				{
+					s.programCounter += (s.keys >> (vx & 0xF) & 1) != 0 ? 4 : 2;
+				}
+				else if (kk == 0xA1)
+				{
+					s.programCounter += (s.keys >> (vx & 0xF) & 1) == 0 ? 4 : 2;
+				}
+				break;
+			case 0xF:
+				switch (kk)
+				{
+				case 0x07: vx = s.delayTimer; break;
+				case 0x0A:
+					if (s.keys == 0)
+					{
+						return;
+					}
+					vx = 1;
+					break;
+				case 0x15: s.delayTimer = vx; break;
+				case 0x18: s.soundTimer = vx; break;
+				case 0x1E:
+					vf = s.index + vx > 0xFFF ? 1 : 0;
+					s.index += vx;
+					break;
+				case 0x29: s.index = fontAddress(vx); break;
+				case 0x33:
+				{
+					auto& digits = BcdTable[vx];
+					for (unsigned int i = 0; i < 3; i++)
+					{
+						s.memory[(s.index + i) & 0xFFF] = digits[i];
+					}
+					break;
+				}
+				case 0x55:
+					for (unsigned int i = 0; i <= x; i++)
+					{
+						s.memory[(s.index + i) & 0xFFF] = s.registers[i];
+					}
+					s.index += x + 1u;
+					break;
+				case 0x65:
+					for (unsigned int i = 0; i <= x; i++)
+					{
+						s.registers[i] = s.memory[(s.index + i) & 0xFFF];
+					}
+					s.index += x + 1u;
+					break;
+				default: return;
+				}
+				s.programCounter += 2;
+				break;
+			}
+		}
+
+		//Once per frame; returns true when the sound timer expires
+		constexpr bool tick(State& s)
+		{
+			if (s.delayTimer > 0)
+			{
+				s.delayTimer--;
+			}
+			if (s.soundTimer > 0)
+			{
+				s.soundTimer--;
+				return s.soundTimer == 0;
+			}
+			return false;
+		}
+
+		constexpr State run(State s, unsigned int frames, unsigned int cyclesPerFrame = 540 / 60)
+		{
+			for (unsigned int frame = 0; frame < frames; frame++)
+			{
+				for (unsigned int cycle = 0; cycle < cyclesPerFrame; cycle++)
+				{
+					step(s);
+				}
+				tick(s);
+			}
+			return s;
+		}
+
+	};
+};
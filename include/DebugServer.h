@@ -0,0 +1,54 @@
+//GDB-remote-style stub for the debug engine, over a local TCP or Unix socket.
+//It is polled from the frontend's frame loop, so the machine is only ever touched from one thread.
+//
+//Supported packets: ? g p m c s Z0-Z4 z0-z4 D k qSupported qAttached QStartNoAckMode qRcmd, Ctrl-C,
+//plus n (step over a 2nnn call, answered with a stop reply like c and s).
+//Registers are numbered V0-VF = 0-15, I = 16, PC = 17, SP = 18, DT = 19, ST = 20; g sends them
+//in that order, I and PC as 2 big-endian bytes and the rest as 1 byte.
+//Monitor commands: "watch <reg>" and "unwatch <reg>", with reg one of v0-vf or i.
+
+#pragma once
+
+#include "Debugger.h"
+#include "Socket.h"
+#include <string>
+
+namespace Chip8 {
+
+	class DebugServer {
+
+	private:
+		Net::Handle _client;
+		Debugger& _debugger;
+		std::string _input;
+		DebugStop _lastStop;
+		Net::Handle _listener;
+		bool _noAck;
+		bool _running;
+
+		void disconnect();
+		void handlePacket(const std::string& packet);
+		std::string monitor(const std::string& command);
+		std::string readRegisters() const;
+		void reportStop(const DebugStop& stop);
+		void sendPacket(const std::string& payload);
+		std::string stopReply(const DebugStop& stop) const;
+
+	public:
+		//Throws std::runtime_error if the address cannot be listened on
+		DebugServer(Debugger& debugger, const std::string& address);
+		~DebugServer();
+
+		DebugServer(const DebugServer&) = delete;
+		DebugServer& operator=(const DebugServer&) = delete;
+
+		//While attached, the guest only runs through poll(); the machine is stopped on attach
+		//and runs freely again once the client detaches or disconnects
+		bool attached() const { return _client != Net::InvalidHandle; }
+
+		//Accepts a client, serves pending packets and, while the guest is continued, runs up to
+		//cycles under the debug engine. Returns true if any guest time passed.
+		bool poll(unsigned int cycles);
+
+	};
+};
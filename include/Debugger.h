@@ -0,0 +1,88 @@
+//Debug engine for a Machine: PC breakpoints, memory and register watchpoints, single-step and step-over.
+//It drives the machine one instruction at a time from the outside, so the normal interpreter loop
+//carries no debug checks at all; frontends only switch to it while a debugger is attached.
+
+#pragma once
+
+#include "Machine.h"
+#include <bitset>
+
+namespace Chip8 {
+
+	enum class StopReason
+	{
+		None,			//Cycle budget used up, still running
+		Step,			//Single-step or step-over finished
+		Breakpoint,
+		ReadWatch,
+		WriteWatch,
+		AccessWatch,
+		RegisterWatch,
+		Interrupt		//Stopped on request
+	};
+
+	struct DebugStop
+	{
+		StopReason reason;
+		unsigned short address;		//Breakpoint or watched address that fired
+		unsigned char reg;			//Register that changed, for RegisterWatch
+	};
+
+	class Debugger {
+
+	public:
+		enum WatchKind
+		{
+			WatchRead = 1,
+			WatchWrite = 2,
+			WatchAccess = WatchRead | WatchWrite
+		};
+
+		//Register numbers for watches and inspection: V0-VF are 0-15
+		static const unsigned char IndexRegister = 16;
+		static const unsigned char RegisterCount = 17;
+
+	private:
+		std::bitset<Memory::Size> _breakpoints;
+		Machine& _machine;
+		unsigned int _registerWatches;
+		bool _resuming;
+		bool _stepOverActive;
+		unsigned short _stepOverReturn;
+		unsigned short _stepOverStack;
+		std::array<unsigned char, Memory::Size> _watchpoints;
+		unsigned int _watchpointCount;
+
+		unsigned short registerOf(unsigned char reg) const;
+		DebugStop checkWatches(unsigned short address, unsigned short length, int kind) const;
+		DebugStop executeOne();
+		DebugStop stopped(DebugStop stop);
+
+	public:
+		Debugger(Machine& machine);
+
+		Machine& machine() { return _machine; }
+		const Machine& machine() const { return _machine; }
+
+		//Each returns false for an address outside guest memory or a register number out of range
+		bool setBreakpoint(unsigned short address);
+		bool clearBreakpoint(unsigned short address);
+		bool setWatchpoint(unsigned short address, unsigned short length, WatchKind kind);
+		bool clearWatchpoint(unsigned short address, unsigned short length, WatchKind kind);
+		bool watchRegister(unsigned char reg);
+		bool unwatchRegister(unsigned char reg);
+		void clearAll();
+
+		//Register inspection; 16-bit so the index register fits
+		unsigned short readRegister(unsigned char reg) const;
+
+		//Executes one instruction; watchpoints can still report, anything else reports Step
+		DebugStop step();
+		//Like step, but runs a whole 2nnn call (up to maxCycles); finish it with run() if the result is None
+		DebugStop stepOver(unsigned int maxCycles);
+		//Runs until a breakpoint, watchpoint or finished step-over, or until maxCycles have run (None).
+		//After a stop, the breakpoint at the stopped instruction does not fire again, so the run can be resumed.
+		DebugStop run(unsigned int maxCycles);
+
+	};
+};
@@ -0,0 +1,113 @@
+//Batched, headless Gym-style environment over many machines running the same ROM.
+//See chip8_env.h for the C ABI.
+
+#pragma once
+
+#include "Machine.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Chip8 {
+
+	//Turns guest state into a reward. Each machine in a batch gets its own clone.
+	class RewardExtractor {
+
+	public:
+		virtual ~RewardExtractor() = default;
+
+		virtual std::unique_ptr<RewardExtractor> clone() const = 0;
+
+		//Called after the machine is (re)started, before the first step of an episode
+		virtual void reset(const Machine& machine) = 0;
+
+		//Reward earned since the previous call; set done to end the episode
+		virtual float reward(const Machine& machine, bool& done) = 0;
+	};
+
+	//Score kept in guest memory, as plain big-endian bytes or one BCD digit per byte (as written by Fx33).
+	//The reward is the change in score. Optionally, the episode ends once a byte reaches a given value.
+	class MemoryScoreReward : public RewardExtractor {
+
+	private:
+		unsigned short _address;
+		bool _bcd;
+		unsigned short _doneAddress;
+		bool _hasDoneCondition;
+		unsigned char _doneValue;
+		unsigned short _length;
+		long long _lastScore;
+
+		long long score(const Machine& machine) const;
+
+	public:
+		//Both throw std::invalid_argument for bytes outside the 4K address space
+		MemoryScoreReward(unsigned short address, unsigned short length, bool bcd);
+
+		void setDoneCondition(unsigned short address, unsigned char value);
+
+		std::unique_ptr<RewardExtractor> clone() const override;
+		void reset(const Machine& machine) override;
+		float reward(const Machine& machine, bool& done) override;
+	};
+
+	//Reward computed by a caller-supplied function
+	class CallbackReward : public RewardExtractor {
+
+	public:
+		typedef std::function<float(const Machine&, bool&)> Callback;
+
+	private:
+		Callback _callback;
+
+	public:
+		CallbackReward(Callback callback);
+
+		std::unique_ptr<RewardExtractor> clone() const override;
+		void reset(const Machine& machine) override;
+		float reward(const Machine& machine, bool& done) override;
+	};
+
+	//A batch of independent machines stepped together. Not thread-safe; to use several cores,
+	//give each thread its own Environment (they share only the immutable ROM image).
+	class Environment {
+
+	private:
+		std::vector<unsigned long long> _episodeFrames;
+		std::vector<unsigned int> _episodes;
+		unsigned int _frameSkip;
+		Machine _initial;
+		std::vector<Machine> _machines;
+		unsigned long long _maxEpisodeFrames;
+		std::vector<unsigned char> _needsReset;
+		std::unique_ptr<RewardExtractor> _reward;
+		std::vector<std::unique_ptr<RewardExtractor>> _rewards;
+		unsigned int _seed;
+
+		void resetOne(size_t index);
+
+	public:
+		//Cycles per emulated frame, matching the windowed frontend's clock
+		static const unsigned int CyclesPerFrame = 540 / 60;
+
+		Environment(const unsigned char* rom, size_t romSize, size_t batchSize, unsigned int frameSkip = 4, unsigned int seed = 1);
+
+		size_t batchSize() const { return _machines.size(); }
+		static size_t observationSize() { return Machine::PackedFramebufferSize; }
+
+		//Episodes longer than this are cut off and reported as done (0 = no limit)
+		void setMaxEpisodeFrames(unsigned long long frames);
+		void setRewardExtractor(std::unique_ptr<RewardExtractor> reward);
+
+		//observations must hold batchSize() * observationSize() bytes
+		void reset(unsigned char* observations);
+
+		//actions: one 16-bit key mask per machine, held for frameSkip frames.
+		//Machines that finished on the previous step are reset before stepping.
+		void step(const unsigned short* actions, unsigned char* observations, float* rewards, unsigned char* dones);
+
+		//Throws std::out_of_range past the end of the batch
+		const Machine& machine(size_t index) const;
+
+	};
+};
@@ -0,0 +1,77 @@
+//Records presented frames to disk as a Y4M video or a numbered PNG sequence.
+//The emulation thread only packs and compares the framebuffer; encoding and file I/O happen on a
+//background thread, fed through a bounded single-producer/single-consumer ring that never blocks.
+
+#pragma once
+
+#include "Machine.h"
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Chip8 {
+
+	class FrameCapture {
+
+	public:
+		enum class Format
+		{
+			Y4M,		//One 64x32 (times scale) greyscale video at 60fps; repeated frames are re-emitted
+			Png			//"name.png" becomes name_000000.png, name_000001.png...; repeated frames are skipped
+		};
+
+	private:
+		struct Slot
+		{
+			unsigned long long frame;
+			std::array<unsigned char, Machine::PackedFramebufferSize> pixels;
+		};
+
+		static const size_t QueueSize = 256;
+
+		std::atomic<unsigned long long> _dropped;
+		std::thread _encoder;
+		std::ofstream _file;
+		Format _format;
+		unsigned long long _frames;
+		std::atomic<size_t> _head;
+		bool _hasLast;
+		std::array<unsigned char, Machine::PackedFramebufferSize> _last;
+		std::string _path;
+		std::vector<Slot> _queue;
+		unsigned int _scale;
+		std::atomic<bool> _stopping;
+		std::atomic<unsigned long long> _submitted;
+		std::atomic<size_t> _tail;
+		std::atomic<unsigned long long> _written;
+
+		void encodeLoop();
+		void writePng(const Slot& slot);
+		void writeY4m(const std::vector<unsigned char>& frame, unsigned long long count);
+		void expand(const Slot& slot, std::vector<unsigned char>& luma) const;
+
+	public:
+		//Format is picked from the extension (.y4m, otherwise PNG). Scale enlarges each pixel to
+		//scale x scale. Throws std::runtime_error if a Y4M file cannot be created.
+		FrameCapture(const std::string& path, unsigned int scale = 1);
+		~FrameCapture();
+
+		FrameCapture(const FrameCapture&) = delete;
+		FrameCapture& operator=(const FrameCapture&) = delete;
+
+		//Call once per presented frame. Unchanged frames are not queued; if the encoder falls
+		//more than a queue's worth behind, the frame is dropped rather than waiting.
+		void submit(const Machine& machine);
+		//Counts frames known to show the same picture as the last submitted one, without looking at them
+		void repeat(unsigned long long frames);
+
+		Format format() const { return _format; }
+		unsigned long long frames() const { return _frames; }
+		unsigned long long dropped() const { return _dropped.load(std::memory_order_relaxed); }
+		//Distinct frames encoded so far
+		unsigned long long written() const { return _written.load(std::memory_order_relaxed); }
+
+	};
+};
@@ -0,0 +1,36 @@
+//Power-aware host frame pacing - lets the frontend sleep while the guest is idle
+//and catch emulated time back up when it wakes.
+
+#pragma once
+
+#include <chrono>
+
+namespace Chip8 {
+
+	class FramePacer {
+
+	private:
+		std::chrono::steady_clock::duration _frameTime;
+		std::chrono::steady_clock::time_point _last;
+		std::chrono::steady_clock::duration _maxSleep;
+		unsigned int _maxCatchUp;
+		std::chrono::steady_clock::duration _owed;
+		bool _started;
+		unsigned long long _sleeps;
+
+	public:
+		FramePacer(unsigned int framesPerSecond, std::chrono::milliseconds maxSleep, unsigned int maxCatchUp = 60);
+
+		//Emulated frames owed since the previous call, going by the wall clock.
+		//The first call always returns one.
+		unsigned int framesDue();
+
+		//Sleeps through one frame (or maxSleep, if shorter) when at least one more whole frame is idle,
+		//so input is polled again within a frame. Input doesn't cut the sleep short, so this saves the
+		//frame's work but not the wakeup. Returns true if the thread actually slept.
+		bool sleepIdle(unsigned long long idleFrames);
+
+		unsigned long long sleeps() const { return _sleeps; }
+
+	};
+};
@@ -0,0 +1,85 @@
+//Input-to-photon latency: follows a key transition from where it is sampled, to the first instruction
+//that reads it (Ex9E / ExA1 / Fx0A), to the next Dxyn that changes the screen, to the present.
+//Stages are timed in emulated cycles, so headless runs measure the same thing as windowed ones.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace Chip8 {
+
+	class LatencyTracker {
+
+	public:
+		//Passed to observed() by instructions that read every key (Fx0A)
+		static const unsigned char AnyKey = 0xFF;
+
+		enum Stage
+		{
+			Poll,			//Sampled -> read by the guest
+			Draw,			//Read -> first Dxyn that changes gfx
+			Present,		//Drawn -> presented
+			Total,
+			StageCount
+		};
+
+	private:
+		enum class State
+		{
+			Idle,
+			Sampled,
+			Observed,
+			Drawn
+		};
+
+		unsigned long long _drawnAt;
+		unsigned long long _observedAt;
+		unsigned char _key;
+		unsigned long long _sampledAt;
+		std::chrono::steady_clock::time_point _sampledWall;
+		std::array<std::vector<unsigned int>, StageCount> _samples;
+		State _state;
+		unsigned long long _superseded;
+		std::vector<double> _wall;
+		bool _wallClock;
+
+	public:
+		//With wallClock set, the report also has the host time from sampling to present
+		LatencyTracker(bool wallClock = false);
+
+		//A key mask was sampled into the machine; the lowest changed key is followed.
+		//A transition still in flight is abandoned.
+		void keyChanged(unsigned short before, unsigned short after, unsigned long long cycle);
+		void observed(unsigned char key, unsigned long long cycle);
+		void drawn(unsigned long long cycle);
+		void presented(unsigned long long cycle);
+
+		size_t completed() const { return _samples[Total].size(); }
+		unsigned long long superseded() const { return _superseded; }
+
+		//Percentiles per stage and a histogram of the total, in milliseconds at the given clock
+		std::string report(double cyclesPerSecond) const;
+
+	};
+
+	//Synthetic key presses for headless latency runs: toggles a key mask every period frames,
+	//at a pseudo-random cycle inside the frame so sampling lands at every point of the batch.
+	class InputInjector {
+
+	private:
+		bool _down;
+		unsigned short _mask;
+		unsigned int _period;
+		unsigned int _state;
+
+	public:
+		InputInjector(unsigned short mask, unsigned int periodFrames, unsigned int seed = 1);
+
+		//True if the keys change during this frame; cycle is the offset into the frame
+		bool due(unsigned long long frame, unsigned int cyclesPerFrame, unsigned int& cycle, unsigned short& keys);
+
+	};
+};
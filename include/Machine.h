@@ -0,0 +1,186 @@
+//Headless CHIP-8 machine - registers, memory, timers and opcode semantics.
+//Has no NovelRT dependency, so it can be driven without a window (see CPU for the NovelRT frontend).
+
+#pragma once
+
+#include "Core.h"
+#include "LatencyTracker.h"
+#include "Memory.h"
+#include "Profiler.h"
+#include <array>
+#include <stdexcept>
+#include <string>
+
+namespace Chip8 {
+
+	//What the guest is spinning on at the current program counter, if anything
+	enum class IdleLoop
+	{
+		None,
+		Halt,			//1nnn jumping to itself
+		KeyWait,		//Fx0A with no key down
+		KeyPoll,		//Ex9E / ExA1 followed by a 1nnn back to it
+		DelayWait		//Fx07, 3xkk, 1nnn back to the Fx07
+	};
+
+	enum class FaultKind
+	{
+		Fetch,				//Instruction fetch running past the end of memory
+		StackOverflow,		//2nnn with all 16 stack entries in use
+		StackUnderflow,		//00EE with an empty stack
+		MemoryRead,			//Dxyn / Fx65 reading past the end of memory
+		MemoryWrite,		//Fx33 / Fx55 writing past the end of memory
+		KeyIndex			//Ex9E / ExA1 with Vx above 0xF
+	};
+
+	//Out of range guest access. Only raised when the core is built with CHIP8_BOUNDS_CHECKED
+	//(the fuzzing build); the regular build wraps addresses, stack depth and key numbers instead, as Core::step does.
+	class MachineFault : public std::runtime_error {
+
+	public:
+		FaultKind kind;
+		unsigned short programCounter;
+		unsigned short opcode;			//Instruction that faulted (for Fetch, the one before it)
+		unsigned int address;			//Offending address, stack depth or key number
+
+		MachineFault(FaultKind kind, unsigned short programCounter, unsigned short opcode, unsigned int address);
+	};
+
+	class Machine {
+
+	protected:
+		unsigned long long _cycleCount;
+		unsigned char _delayTimer;
+		unsigned long long _drawCount;
+		unsigned short _index;
+		LatencyTracker* _latency;
+		unsigned short _opcode;
+		unsigned short _programCounter;
+		Profiler* _profiler;
+		unsigned int _randomState;
+		unsigned long long _romHash;
+		unsigned char _soundTimer;
+		unsigned short _sp;
+
+		Memory _memory;
+		std::array<unsigned short, 16> _stack;
+		std::array<unsigned char, 16> _vRegister;
+
+		static std::shared_ptr<const Memory::Image> fontImage();
+		unsigned char nextRandom();
+		unsigned short opcodeAt(unsigned short address) const;
+		bool isIdleIteration(IdleLoop loop, unsigned short head) const;
+		[[noreturn]] void fault(FaultKind kind, unsigned int address) const;
+
+	public:
+		bool drawFlag;
+		std::array<unsigned char, 2048> gfx;
+		std::array<unsigned char, 16> key;
+
+		Machine();
+
+		//Returns true when the sound timer expires and a beep should be played
+		bool cycleTimers();
+		void emulateCycle();
+		size_t loadProgram(const unsigned char* data, size_t size);
+		size_t loadProgram(const std::string& fileName);
+		void seed(unsigned int seed);
+		void setLatencyTracker(LatencyTracker* latency);
+		void setProfiler(Profiler* profiler);
+
+		//Cheap clone for tree search: the font set and loaded ROM stay shared copy-on-write, and
+		//only registers, stack, timers, dirtied memory pages and gfx are copied. The clone has no
+		//profiler or latency tracker attached, and forking a CPU yields a plain headless Machine without its NovelRT services.
+		//Assigning one Machine to another reuses the destination's storage the same way.
+		Machine fork() const;
+
+		//Idle-loop detection and skip-ahead, for headless and turbo runs.
+		//Both are equivalent to interpreting every iteration.
+		IdleLoop detectIdleLoop(unsigned short* head = nullptr, unsigned short* length = nullptr) const;
+		unsigned int runCycles(unsigned int cycles, bool skipIdle);
+
+		//How many whole frames the guest will keep idling for with the current keys (0 if busy,
+		//unbounded for a halt or key wait)
+		unsigned long long idleFrames(unsigned int cyclesPerFrame) const;
+		unsigned long long skipIdleFrames(unsigned long long maxFrames, unsigned int cyclesPerFrame);
+
+		//Runs whole frames (cycles, then timers) with idle skipping and no input changes.
+		//Returns how many times the sound timer expired along the way.
+		unsigned int runFrames(unsigned long long frames, unsigned int cyclesPerFrame);
+
+		//Read-only views of guest state, for tools built on top of the machine
+		unsigned char peek(unsigned short address) const { return _memory[address]; }
+		unsigned char registerValue(unsigned char x) const { return _vRegister[x & 0xF]; }
+		unsigned short indexRegister() const { return _index; }
+		unsigned short programCounter() const { return _programCounter; }
+		unsigned short stackPointer() const { return _sp; }
+		unsigned short stackEntry(unsigned char level) const { return _stack[level & 0xF]; }
+		unsigned char delayTimer() const { return _delayTimer; }
+		unsigned char soundTimer() const { return _soundTimer; }
+		unsigned short currentOpcode() const { return _opcode; }
+
+		//Running totals: emulated cycles (including skipped idle ones) and Dxyn sprite draws
+		unsigned long long cycleCount() const { return _cycleCount; }
+		unsigned long long drawCount() const { return _drawCount; }
+		//64-bit FNV-1a of the loaded ROM, 0 before one is loaded
+		unsigned long long romHash() const { return _romHash; }
+
+		//Keys as a 16-bit mask, bit n set while key n is down
+		unsigned short keyMask() const;
+		void setKeyMask(unsigned short mask);
+
+		//64x32 framebuffer as 256 bytes, one bit per pixel, rows top to bottom, MSB = leftmost pixel
+		static const size_t PackedFramebufferSize = 2048 / 8;
+		void packFramebuffer(unsigned char* out) const;
+		//64-bit FNV-1a of the packed framebuffer, so it doesn't depend on how gfx is stored
+		unsigned long long framebufferHash() const;
+		//64-bit FNV-1a of the whole 4K address space as the guest sees it
+		unsigned long long memoryHash() const;
+
+		//Architectural state as the constexpr core sees it, and back. Loading only writes the memory
+		//bytes that differ, so untouched pages stay shared; tool hooks see none of the instructions.
+		Core::State coreState() const;
+		void loadCoreState(const Core::State& state);
+
+		static std::string disassemble(unsigned short opcode);
+		//Whether emulateCycle executes this opcode (disassemble gives "" otherwise); never allocates
+		static bool implemented(unsigned short opcode);
+
+		//Opcode Functions
+		void op00E0();
+		void op00EE();
+		void op1nnn();
+		void op2nnn();
+		void op3xkk();
+		void op4xkk();
+		void op5xy0();
+		void op6xkk();
+		void op7xkk();
+		void op8xy0();
+		void op8xy1();
+		void op8xy2();
+		void op8xy3();
+		void op8xy4();
+		void op8xy5();
+		void op8xy6();
+		void op8xy7();
+		void op8xyE();
+		void op9xy0();
+		void opAnnn();
+		void opBnnn();
+		void opCxkk();
+		void opDxyn();
+		void opEx9E();
+		void opExA1();
+		void opFx07();
+		void opFx0A();
+		void opFx15();
+		void opFx18();
+		void opFx1E();
+		void opFx29();
+		void opFx33();
+		void opFx55();
+		void opFx65();
+
+	};
+};
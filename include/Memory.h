@@ -0,0 +1,53 @@
+//Copy-on-write CHIP-8 address space.
+//The loaded image (font set + ROM) is shared between copies; a page is only duplicated
+//the first time a copy writes to it, so copying a Memory costs the pages it has dirtied.
+
+#pragma once
+
+#include <array>
+#include <memory>
+
+namespace Chip8 {
+
+	class Memory {
+
+	public:
+		static const unsigned short Size = 4096;
+		static const unsigned short PageSize = 256;
+		static const unsigned short PageCount = Size / PageSize;
+
+		typedef std::array<unsigned char, Size> Image;
+
+	private:
+		std::shared_ptr<const Image> _image;
+		std::array<const unsigned char*, PageCount> _pages;
+		std::array<std::array<unsigned char, PageSize>, PageCount> _private;
+		unsigned short _dirtyMask;
+
+		void copyFrom(const Memory& other);
+
+	public:
+		Memory(std::shared_ptr<const Image> image);
+		Memory(const Memory& other);
+		Memory& operator=(const Memory& other);
+
+		//Guest addresses wrap at 4K, as in Core::step
+		unsigned char operator[](unsigned short address) const
+		{
+			address &= Size - 1;
+			return _pages[address / PageSize][address % PageSize];
+		}
+
+		void write(unsigned short address, unsigned char value);
+
+		//Replaces the shared image and drops every private page
+		void reset(std::shared_ptr<const Image> image);
+
+		//Copy of the whole address space as the guest currently sees it
+		Image snapshot() const;
+
+		unsigned int privatePages() const;
+		const std::shared_ptr<const Image>& image() const { return _image; }
+
+	};
+};
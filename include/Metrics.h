@@ -0,0 +1,65 @@
+//Live runtime counters, served in Prometheus text format on a local socket.
+//The emulator thread only ever does relaxed atomic adds/stores; all formatting
+//and percentile math happens on the server thread when someone scrapes.
+
+#pragma once
+
+#include "Socket.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace Chip8 {
+
+	struct Metrics
+	{
+		static const size_t FrameTimeBuckets = 12;
+		//Upper bounds in seconds; the last bucket is +Inf
+		static const std::array<double, FrameTimeBuckets> FrameTimeBounds;
+
+		std::atomic<unsigned long long> instructions{ 0 };
+		std::atomic<unsigned long long> framesPresented{ 0 };
+		std::atomic<unsigned long long> framebufferUpdates{ 0 };
+		std::atomic<unsigned long long> draws{ 0 };
+		std::atomic<unsigned long long> beepsSilent{ 0 };
+		std::atomic<unsigned long long> beepsCutOff{ 0 };
+		std::array<std::atomic<unsigned long long>, FrameTimeBuckets> frameTimes{};
+		std::atomic<unsigned long long> frameTimeTotalMicros{ 0 };
+		std::atomic<unsigned long long> romHash{ 0 };
+		std::atomic<unsigned int> clockHz{ 0 };
+
+		static void add(std::atomic<unsigned long long>& counter, unsigned long long value)
+		{
+			counter.fetch_add(value, std::memory_order_relaxed);
+		}
+
+		void recordFrameTime(std::chrono::steady_clock::duration frameTime);
+
+		//Prometheus text exposition; instructionsPerSecond is measured by the caller between scrapes
+		std::string render(double instructionsPerSecond) const;
+		double frameTimePercentile(double percentile) const;
+	};
+
+	//Answers every connection on the socket with the current metrics and closes it.
+	//Plain HTTP GETs get an HTTP response, so Prometheus or `curl --unix-socket` can scrape it directly.
+	class MetricsServer {
+
+	private:
+		Net::Handle _listener;
+		const Metrics& _metrics;
+		std::atomic<bool> _stopping;
+		std::thread _thread;
+
+		void serve();
+
+	public:
+		MetricsServer(const Metrics& metrics, const std::string& address);
+		~MetricsServer();
+
+		MetricsServer(const MetricsServer&) = delete;
+		MetricsServer& operator=(const MetricsServer&) = delete;
+
+	};
+};
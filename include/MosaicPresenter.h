@@ -0,0 +1,57 @@
+//Batched presenter for many machines in one NovelRT window.
+//Every instance's framebuffer is packed into one 1-bit atlas each frame; only the cells whose bits
+//changed are laid out again, as one rect per horizontal run of lit pixels drawn from a shared pool.
+//A wall of K screens costs a few hundred scene objects rather than K x 2048.
+
+#pragma once
+
+#include "../build/_deps/novelrt-src/include/NovelRT.h"
+#include "Machine.h"
+#include <memory>
+#include <vector>
+
+namespace Chip8 {
+
+	class MosaicPresenter {
+
+	private:
+		struct Cell
+		{
+			float left;
+			float top;
+			std::vector<unsigned int> rects;
+		};
+
+		std::vector<unsigned char> _atlas;
+		std::vector<Cell> _cells;
+		std::vector<bool> _dirty;
+		std::array<std::unique_ptr<NovelRT::Graphics::BasicFillRect>, 4> _focusFrame;
+		std::vector<unsigned int> _free;
+		float _pixelSize;
+		std::vector<std::unique_ptr<NovelRT::Graphics::BasicFillRect>> _pool;
+		std::weak_ptr<NovelRT::Graphics::RenderingService> _renderer;
+		std::vector<unsigned char> _shown;
+
+		unsigned int acquire();
+		void layout(size_t cell);
+
+	public:
+		//Tiles count screens into a grid filling width x height (top left at 0,0), keeping the 2:1 aspect
+		MosaicPresenter(std::weak_ptr<NovelRT::Graphics::RenderingService> renderer, size_t count, float width, float height);
+
+		//Copies the machine's framebuffer into its atlas slot if it drew since the last call
+		void update(size_t index, Machine& machine);
+
+		//Re-lays the cells whose atlas bits changed since the last present; returns how many did
+		size_t present();
+
+		//Outlines the instance that receives keyboard input
+		void setFocus(size_t index);
+
+		//Scene construction: draws the focus outline and every lit run
+		void draw();
+
+		size_t activeRects() const { return _pool.size() - _free.size(); }
+
+	};
+};
@@ -0,0 +1,63 @@
+//Two-player rollback netplay over a Transport.
+//Both peers run the same ROM on one shared keypad; the machine sees the OR of both players' key masks.
+//Each frame the remote mask is predicted (last one received), the state before the frame is kept,
+//and when a prediction turns out wrong the machine is rewound and the frames since are re-run.
+
+#pragma once
+
+#include "Machine.h"
+#include "Transport.h"
+#include <vector>
+
+namespace Chip8 {
+
+	class Netplay {
+
+	private:
+		//Frames of input kept for resends and rollback; larger than any sensible rollback window
+		static const unsigned int History = 128;
+		//Unacknowledged local inputs resent in every packet
+		static const unsigned int Redundancy = 32;
+
+		unsigned int _cyclesPerFrame;
+		unsigned long long _frame;
+		std::vector<unsigned short> _local;
+		long long _localAcked;
+		Machine& _machine;
+		unsigned int _maxRollback;
+		std::vector<unsigned short> _predicted;
+		std::vector<unsigned short> _remote;
+		long long _remoteConfirmed;
+		unsigned long long _resimulated;
+		bool _romMismatch;
+		long long _rollbackFrom;
+		unsigned long long _rollbacks;
+		std::vector<Machine> _snapshots;
+		unsigned long long _stalls;
+		Transport& _transport;
+
+		long long receive();
+		unsigned short remoteFor(unsigned long long frame) const;
+		void sendInputs(long long last);
+		unsigned int simulate(unsigned long long frame);
+
+	public:
+		//maxRollback: how many frames the local side may run ahead of the last confirmed remote input
+		Netplay(Machine& machine, Transport& transport, unsigned int maxRollback = 8, unsigned int cyclesPerFrame = 540 / 60);
+
+		//Runs the next frame with this side's keys, rolling back first if remote input arrived that
+		//contradicts a prediction. Returns false (and runs nothing) while stalled waiting for the peer.
+		//beeps is set to the sound timer expiries of the new frame only.
+		bool advance(unsigned short localKeys, unsigned int& beeps);
+
+		unsigned long long frame() const { return _frame; }
+		//Last frame for which the remote input is known, -1 before any arrived
+		long long confirmedFrame() const { return _remoteConfirmed; }
+		unsigned long long rollbacks() const { return _rollbacks; }
+		unsigned long long resimulatedFrames() const { return _resimulated; }
+		unsigned long long stalls() const { return _stalls; }
+		//The peer is running a different ROM; its packets are ignored
+		bool romMismatch() const { return _romMismatch; }
+
+	};
+};
@@ -0,0 +1,57 @@
+//Guest subroutine profiler - attributes emulated cycles to CALL targets
+//and exports collapsed stacks for flamegraph tooling (flamegraph.pl, speedscope, etc.)
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Chip8 {
+
+	class Profiler {
+
+	private:
+		//Each node is one distinct guest call stack, stored as a trie so the
+		//per-cycle cost is a single increment on the current node.
+		struct Node
+		{
+			unsigned int parent;
+			unsigned short routine;
+			unsigned short depth;
+			unsigned long long cycles;
+		};
+
+		//Calls deeper than the guest stack are folded into one DeeperCalls node; no 12-bit
+		//CALL target can collide with it
+		static const unsigned short MaxDepth = 16;
+		static const unsigned short DeeperCalls = 0xFFFF;
+
+		unsigned int _current;
+		std::unordered_map<unsigned int, std::string> _labels;
+		std::unordered_map<unsigned long long, unsigned int> _children;
+		std::vector<Node> _nodes;
+
+		unsigned int childOf(unsigned int node, unsigned short routine);
+		std::string nameOf(unsigned short routine) const;
+
+	public:
+		Profiler(unsigned short entryPoint = 0x200);
+
+		//Optional sidecar symbol file, one "<hex address> <name>" per line.
+		//Blank lines and lines starting with '#' or ';' are ignored. Throws std::runtime_error naming
+		//the line if an address isn't hex.
+		void loadLabels(const std::string& fileName);
+
+		//Called from the interpreter; sp is the guest stack pointer after the instruction.
+		void countCycle() { _nodes[_current].cycles++; }
+		void countCycles(unsigned long long cycles) { _nodes[_current].cycles += cycles; }
+		void enterRoutine(unsigned short target, unsigned short sp);
+		void leaveRoutine(unsigned short sp);
+
+		unsigned long long totalCycles() const;
+		void reset();
+		void writeCollapsed(const std::string& fileName) const;
+
+	};
+};
@@ -0,0 +1,51 @@
+//Minimal portable socket helpers for the local-only services (metrics, debugger stub, netplay, streaming).
+//Addresses are "unix:<path>" for a Unix domain socket, or "[tcp:]<host>:<port>" for TCP.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Chip8 {
+	namespace Net {
+
+		typedef std::intptr_t Handle;
+		const Handle InvalidHandle = -1;
+
+		//Listening stream socket; throws std::runtime_error on failure.
+		//A stale Unix socket file at the same path is replaced, but a live socket or any other file is an error.
+		//The socket file is removed again by close.
+		Handle listen(const std::string& address);
+		Handle connect(const std::string& address);
+
+		//Returns InvalidHandle if nothing connected within timeoutMs
+		Handle accept(Handle listener, int timeoutMs);
+
+		//Resolved datagram destination, so sending doesn't look the address up for every packet
+		struct Endpoint
+		{
+			alignas(8) unsigned char storage[128];
+			int length;
+		};
+
+		//UDP socket bound to host:port (port 0 picks one); send/receive datagrams with sendTo/receiveFrom
+		Handle bindUdp(const std::string& address);
+		//Throws std::runtime_error if the address cannot be resolved
+		Endpoint resolveUdp(const std::string& address);
+		bool sendTo(Handle socket, const Endpoint& endpoint, const void* data, size_t size);
+		//Returns the datagram size, or -1 if nothing arrived within timeoutMs
+		long receiveFrom(Handle socket, void* data, size_t size, int timeoutMs);
+		unsigned short localPort(Handle socket);
+
+		bool waitReadable(Handle socket, int timeoutMs);
+		bool sendAll(Handle socket, const void* data, size_t size);
+		//For non-blocking sockets: returns bytes sent, 0 if the send buffer is full, -1 on error
+		long sendSome(Handle socket, const void* data, size_t size);
+		//Returns bytes read, 0 on orderly close, -1 on error
+		long receive(Handle socket, void* data, size_t size);
+		void setNonBlocking(Handle socket);
+		void close(Handle socket);
+
+	};
+};
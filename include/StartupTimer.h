@@ -0,0 +1,40 @@
+//Per-phase startup timing, from process start to the first emulated frame, plus any
+//warm-up phases that run once it is out
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace Chip8 {
+
+	class StartupTimer {
+
+	private:
+		struct Phase
+		{
+			const char* name;
+			std::chrono::steady_clock::duration duration;
+		};
+
+		std::chrono::steady_clock::time_point _firstFrame;
+		size_t _firstFramePhases;
+		std::chrono::steady_clock::time_point _last;
+		std::vector<Phase> _phases;
+		std::chrono::steady_clock::time_point _start;
+
+	public:
+		StartupTimer();
+
+		//Ends the current phase under the given name and starts the next one
+		void mark(const char* phase);
+		//Ends the "first frame" phase; later phases are reported separately, after the total
+		void firstFrame();
+
+		//Time to the first frame, or to the latest mark before it is out
+		std::chrono::steady_clock::duration total() const { return (_firstFramePhases > 0 ? _firstFrame : _last) - _start; }
+		std::string report() const;
+
+	};
+};
@@ -0,0 +1,75 @@
+//Framebuffer stream for local viewers over a TCP or Unix socket, with key input coming back.
+//Each frame is encoded once, as the rows that changed, and the same bytes are queued to every viewer.
+//It is polled from the frontend's frame loop, so the machine is only ever touched from one thread.
+//
+//Every message is a 1-byte type, a 2-byte little-endian payload length, then the payload.
+//Server to viewer:
+//  'H' hello:    "C8FS", version 1, width 64, height 32
+//  'F' frame:    4-byte frame number, row count, then per row: row index, run count, runs
+//                A keyframe (first frame for a viewer, or after it fell behind) lists every row.
+//                Runs are pixel counts alternating unlit/lit, starting unlit (possibly 0), summing to 64.
+//Viewer to server:
+//  'K' keys:     2-byte key mask, bit n = key n down; ORed with the local keyboard and other viewers
+
+#pragma once
+
+#include "Machine.h"
+#include "Socket.h"
+#include <array>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Chip8 {
+
+	class StreamServer {
+
+	private:
+		typedef std::shared_ptr<const std::string> Message;
+
+		struct Viewer
+		{
+			Net::Handle socket;
+			std::string input;
+			unsigned short keys;
+			std::deque<Message> queue;
+			size_t queuedBytes;
+			size_t sentOfFront;
+			bool needsKeyframe;
+		};
+
+		//A viewer this far behind is dropped back to the next keyframe instead of buffering more
+		static const size_t MaxQueuedBytes = 64 * 1024;
+
+		unsigned long long _bytesEncoded;
+		unsigned int _frame;
+		Net::Handle _listener;
+		std::array<unsigned char, Machine::PackedFramebufferSize> _previous;
+		bool _started;
+		std::vector<Viewer> _viewers;
+
+		void acceptViewers();
+		Message encode(const std::array<unsigned char, Machine::PackedFramebufferSize>& packed, bool keyframe) const;
+		bool flush(Viewer& viewer);
+		static void enqueue(Viewer& viewer, const Message& message);
+		bool readInput(Viewer& viewer);
+
+	public:
+		//Throws std::runtime_error if the address cannot be listened on
+		StreamServer(const std::string& address);
+		~StreamServer();
+
+		StreamServer(const StreamServer&) = delete;
+		StreamServer& operator=(const StreamServer&) = delete;
+
+		//Accepts viewers, reads their keys, encodes this frame's changes once and sends what each can take
+		void update(const Machine& machine);
+
+		//Keys held by all viewers together
+		unsigned short keyMask() const;
+		size_t viewers() const { return _viewers.size(); }
+		unsigned long long bytesEncoded() const { return _bytesEncoded; }
+
+	};
+};
@@ -0,0 +1,81 @@
+//Chrome/Perfetto trace-event recorder for the frame pipeline.
+//Events are buffered in memory and written as JSON by a background thread; open the
+//output in chrome://tracing or ui.perfetto.dev.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Chip8 {
+
+	class Tracer {
+
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		//Records a complete event for its own lifetime. A null tracer makes it a no-op,
+		//so call sites don't need their own checks.
+		class Span {
+
+		private:
+			const char* _name;
+			Clock::time_point _start;
+			Tracer* _tracer;
+
+		public:
+			Span(Tracer* tracer, const char* name);
+			~Span();
+
+			Span(const Span&) = delete;
+			Span& operator=(const Span&) = delete;
+		};
+
+	private:
+		//Names must be string literals (or otherwise outlive the tracer)
+		struct Event
+		{
+			const char* name;
+			char phase;
+			long long timestamp;
+			long long duration;
+			long long value;
+			unsigned int thread;
+		};
+
+		std::vector<Event> _pending;
+		std::vector<Event> _writing;
+		std::mutex _mutex;
+		std::ofstream _file;
+		bool _first;
+		Clock::time_point _origin;
+		bool _stopping;
+		std::condition_variable _wake;
+		std::thread _writer;
+
+		static const size_t FlushThreshold = 4096;
+
+		long long since(Clock::time_point time) const;
+		void push(const Event& event);
+		void writeLoop();
+		void writeEvents(const std::vector<Event>& events);
+		static unsigned int threadNumber();
+
+	public:
+		Tracer(const std::string& fileName);
+		~Tracer();
+
+		Tracer(const Tracer&) = delete;
+		Tracer& operator=(const Tracer&) = delete;
+
+		void complete(const char* name, Clock::time_point start, Clock::time_point end);
+		void counter(const char* name, long long value);
+		void instant(const char* name);
+
+	};
+};
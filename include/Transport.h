@@ -0,0 +1,42 @@
+//Unreliable, unordered datagram transport between two netplay peers.
+//Implementations must never block; netplay resends whatever matters.
+
+#pragma once
+
+#include "Socket.h"
+#include <string>
+
+namespace Chip8 {
+
+	class Transport {
+
+	public:
+		virtual ~Transport() = default;
+
+		virtual void send(const void* data, size_t size) = 0;
+		//Returns the datagram size, or -1 if nothing is waiting
+		virtual long receive(void* data, size_t size) = 0;
+	};
+
+	//UDP between two fixed addresses ("host:port"); works over loopback for local testing
+	class UdpTransport : public Transport {
+
+	private:
+		Net::Endpoint _remote;
+		Net::Handle _socket;
+
+	public:
+		//Throws std::runtime_error if the local address cannot be bound or the remote one resolved
+		UdpTransport(const std::string& localAddress, const std::string& remoteAddress);
+		~UdpTransport();
+
+		UdpTransport(const UdpTransport&) = delete;
+		UdpTransport& operator=(const UdpTransport&) = delete;
+
+		void send(const void* data, size_t size) override;
+		long receive(void* data, size_t size) override;
+
+		unsigned short localPort() const { return Net::localPort(_socket); }
+
+	};
+};
@@ -0,0 +1,59 @@
+/* C ABI for the batched CHIP-8 environment (Chip8::Environment), for embedding in
+   training pipelines and other languages. Functions that can fail return 0 on success
+   and -1 on error, or NULL from chip8_env_create; chip8_env_last_error() explains why. */
+
+#ifndef CHIP8_ENV_H
+#define CHIP8_ENV_H
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#  if defined(CHIP8_ENV_BUILD)
+#    define CHIP8_ENV_API __declspec(dllexport)
+#  else
+#    define CHIP8_ENV_API __declspec(dllimport)
+#  endif
+#else
+#  define CHIP8_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct chip8_env chip8_env;
+
+/* Reward callback: return the reward for machine `index` since the last call, set *done to 1 to end its episode.
+   Guest state can be read with chip8_env_peek / chip8_env_register from inside the callback. */
+typedef float (*chip8_reward_fn)(const chip8_env* env, unsigned int index, unsigned char* done, void* user);
+
+CHIP8_ENV_API chip8_env* chip8_env_create(const unsigned char* rom, size_t rom_size, unsigned int batch_size,
+	unsigned int frame_skip, unsigned int seed);
+CHIP8_ENV_API void chip8_env_destroy(chip8_env* env);
+
+CHIP8_ENV_API unsigned int chip8_env_batch_size(const chip8_env* env);
+/* Bytes per observation: 64x32 pixels, one bit each, MSB = leftmost */
+CHIP8_ENV_API size_t chip8_env_observation_size(void);
+
+/* The score bytes and the done byte must lie inside the 4K address space */
+CHIP8_ENV_API int chip8_env_set_score_reward(chip8_env* env, unsigned short address, unsigned short length, int bcd);
+CHIP8_ENV_API int chip8_env_set_done_condition(chip8_env* env, unsigned short address, unsigned char value);
+CHIP8_ENV_API int chip8_env_set_reward_callback(chip8_env* env, chip8_reward_fn fn, void* user);
+CHIP8_ENV_API int chip8_env_set_max_episode_frames(chip8_env* env, unsigned long long frames);
+
+/* observations: batch_size * chip8_env_observation_size() bytes; actions, rewards, dones: batch_size entries */
+CHIP8_ENV_API int chip8_env_reset(chip8_env* env, unsigned char* observations);
+CHIP8_ENV_API int chip8_env_step(chip8_env* env, const unsigned short* actions, unsigned char* observations,
+	float* rewards, unsigned char* dones);
+
+/* Fail for an index past the batch, an address above 0xFFF or a register above 0xF */
+CHIP8_ENV_API int chip8_env_peek(const chip8_env* env, unsigned int index, unsigned short address, unsigned char* value);
+CHIP8_ENV_API int chip8_env_register(const chip8_env* env, unsigned int index, unsigned char reg, unsigned char* value);
+
+CHIP8_ENV_API const char* chip8_env_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
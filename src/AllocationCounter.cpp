@@ -0,0 +1,47 @@
+//Counts heap allocations made by the current thread.
+
+#include "AllocationCounter.h"
+#include <cstdlib>
+#include <new>
+
+namespace {
+	thread_local unsigned long long allocationCount = 0;
+};
+
+//The array and nothrow forms fall through to these by default; over-aligned allocations aren't counted
+void* operator new(std::size_t size)
+{
+	allocationCount++;
+	if (void* block = std::malloc(size == 0 ? 1 : size))
+	{
+		return block;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* block) noexcept
+{
+	std::free(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept
+{
+	std::free(block);
+}
+
+namespace Chip8 {
+	AllocationCounter::AllocationCounter() :
+		_start(allocationCount)
+	{
+	}
+
+	unsigned long long AllocationCounter::allocations() const
+	{
+		return allocationCount - _start;
+	}
+
+	unsigned long long AllocationCounter::total()
+	{
+		return allocationCount;
+	}
+};
@@ -0,0 +1,237 @@
+//Differential co-simulation of two execution engines with divergence bisection.
+
+#include "CoSimulator.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace Chip8 {
+	void ReferenceEngine::run(Machine& machine, unsigned int cycles) const
+	{
+		for (unsigned int i = 0; i < cycles; i++)
+		{
+			machine.emulateCycle();
+		}
+	}
+
+	void IdleSkipEngine::run(Machine& machine, unsigned int cycles) const
+	{
+		machine.runCycles(cycles, true);
+	}
+
+	void CoreEngine::run(Machine& machine, unsigned int cycles) const
+	{
+		auto state = machine.coreState();
+		for (unsigned int i = 0; i < cycles; i++)
+		{
+			Core::step(state);
+		}
+		machine.loadCoreState(state);
+	}
+
+	MachineState MachineState::of(const Machine& machine)
+	{
+		MachineState state;
+		for (unsigned char x = 0; x < 16; x++)
+		{
+			state.registers[x] = machine.registerValue(x);
+			state.stack[x] = x < machine.stackPointer() ? machine.stackEntry(x) : 0;
+		}
+		state.index = machine.indexRegister();
+		state.programCounter = machine.programCounter();
+		state.stackPointer = machine.stackPointer();
+		state.delayTimer = machine.delayTimer();
+		state.soundTimer = machine.soundTimer();
+		state.cycles = machine.cycleCount();
+		state.memoryHash = machine.memoryHash();
+		state.framebufferHash = machine.framebufferHash();
+		return state;
+	}
+
+	bool MachineState::operator==(const MachineState& other) const
+	{
+		return registers == other.registers && index == other.index && programCounter == other.programCounter &&
+			stackPointer == other.stackPointer && stack == other.stack && delayTimer == other.delayTimer &&
+			soundTimer == other.soundTimer && cycles == other.cycles && memoryHash == other.memoryHash &&
+			framebufferHash == other.framebufferHash;
+	}
+
+	std::string MachineState::describe(const MachineState* highlight) const
+	{
+		std::ostringstream out;
+		out << std::hex << std::uppercase << std::setfill('0');
+
+		auto mark = [&](bool differs)
+		{
+			return differs ? "*" : "";
+		};
+
+		for (int x = 0; x < 16; x++)
+		{
+			out << mark(highlight && registers[x] != highlight->registers[x]) << "V" << x << "="
+				<< std::setw(2) << static_cast<int>(registers[x]) << " ";
+		}
+		out << mark(highlight && index != highlight->index) << "I=" << std::setw(3) << index << " "
+			<< mark(highlight && programCounter != highlight->programCounter) << "PC=" << std::setw(3) << programCounter << " "
+			<< mark(highlight && (stackPointer != highlight->stackPointer || stack != highlight->stack)) << "SP="
+			<< stackPointer << " [";
+		for (unsigned short level = 0; level < stackPointer && level < 16; level++)
+		{
+			out << (level > 0 ? " " : "") << std::setw(3) << stack[level];
+		}
+		out << "] "
+			<< mark(highlight && delayTimer != highlight->delayTimer) << "DT=" << std::setw(2) << static_cast<int>(delayTimer) << " "
+			<< mark(highlight && soundTimer != highlight->soundTimer) << "ST=" << std::setw(2) << static_cast<int>(soundTimer) << " "
+			<< std::dec << mark(highlight && cycles != highlight->cycles) << "cycles=" << cycles << " " << std::hex
+			<< mark(highlight && memoryHash != highlight->memoryHash) << "memory=" << std::setw(16) << memoryHash << " "
+			<< mark(highlight && framebufferHash != highlight->framebufferHash) << "gfx=" << std::setw(16) << framebufferHash;
+		return out.str();
+	}
+
+	std::string Divergence::report(const Engine& referenceEngine, const Engine& candidateEngine) const
+	{
+		std::ostringstream out;
+		out << candidateEngine.name() << " diverges from " << referenceEngine.name() << " at instruction " << instruction
+			<< ": " << Machine::disassemble(opcode) << " at 0x" << std::hex << std::uppercase << std::setfill('0')
+			<< std::setw(3) << programCounter << std::dec;
+		if (frameBoundary)
+		{
+			out << " (end of a frame: timers and keys were applied after it)";
+		}
+		out << "\n";
+		if (chunkDependent)
+		{
+			out << "Single-stepping this instruction agrees; the difference only shows up when it runs as part of a larger batch.\n";
+		}
+		out << "  before     " << before.describe() << "\n";
+		out << std::setfill(' ') << std::left;
+		out << "  " << std::setw(10) << referenceEngine.name() << " " << reference.describe(&candidate) << "\n";
+		out << "  " << std::setw(10) << candidateEngine.name() << " " << candidate.describe(&reference) << "\n";
+		return out.str();
+	}
+
+	CoSimulator::CoSimulator(const Engine& reference, const Engine& candidate, unsigned int interval, unsigned int cyclesPerFrame) :
+		_candidate(candidate),
+		_checks(0),
+		_cyclesPerFrame(cyclesPerFrame == 0 ? 1 : cyclesPerFrame),
+		_interval(interval == 0 ? 1 : interval),
+		_reference(reference)
+	{
+	}
+
+	void CoSimulator::setKeys(unsigned long long frame, unsigned short mask)
+	{
+		auto entry = std::make_pair(frame, mask);
+		auto at = std::upper_bound(_keys.begin(), _keys.end(), entry,
+			[](const std::pair<unsigned long long, unsigned short>& a, const std::pair<unsigned long long, unsigned short>& b)
+			{
+				return a.first < b.first;
+			});
+		if (at != _keys.begin() && (at - 1)->first == frame)
+		{
+			(at - 1)->second = mask;
+			return;
+		}
+		_keys.insert(at, entry);
+	}
+
+	unsigned short CoSimulator::keysAt(unsigned long long frame) const
+	{
+		unsigned short mask = 0;
+		for (auto& entry : _keys)
+		{
+			if (entry.first > frame)
+			{
+				break;
+			}
+			mask = entry.second;
+		}
+		return mask;
+	}
+
+	void CoSimulator::advance(Machine& machine, const Engine& engine, unsigned long long from, unsigned long long to) const
+	{
+		while (from < to)
+		{
+			auto chunk = std::min<unsigned long long>(to - from, _cyclesPerFrame - from % _cyclesPerFrame);
+			engine.run(machine, static_cast<unsigned int>(chunk));
+			from += chunk;
+
+			if (from % _cyclesPerFrame == 0)
+			{
+				machine.cycleTimers();
+				machine.setKeyMask(keysAt(from / _cyclesPerFrame));
+			}
+		}
+	}
+
+	Divergence CoSimulator::bisect(Machine reference, Machine candidate, unsigned long long from, unsigned long long to) const
+	{
+		//Invariant: the engines agree after `from` instructions and disagree after `to`
+		while (to - from > 1)
+		{
+			auto middle = from + (to - from) / 2;
+			auto probeReference = reference;
+			auto probeCandidate = candidate;
+			advance(probeReference, _reference, from, middle);
+			advance(probeCandidate, _candidate, from, middle);
+
+			if (MachineState::of(probeReference) == MachineState::of(probeCandidate))
+			{
+				reference = probeReference;
+				candidate = probeCandidate;
+				from = middle;
+			}
+			else
+			{
+				to = middle;
+			}
+		}
+
+		Divergence divergence;
+		divergence.instruction = from;
+		divergence.programCounter = reference.programCounter();
+		divergence.opcode = static_cast<unsigned short>(reference.peek(divergence.programCounter) << 8 |
+			reference.peek(static_cast<unsigned short>((divergence.programCounter + 1) % Memory::Size)));
+		divergence.frameBoundary = to % _cyclesPerFrame == 0;
+		divergence.before = MachineState::of(reference);
+
+		advance(reference, _reference, from, to);
+		advance(candidate, _candidate, from, to);
+		divergence.reference = MachineState::of(reference);
+		divergence.candidate = MachineState::of(candidate);
+		divergence.chunkDependent = divergence.reference == divergence.candidate;
+		return divergence;
+	}
+
+	bool CoSimulator::run(const Machine& start, unsigned long long instructions, Divergence& divergence)
+	{
+		auto reference = start.fork();
+		reference.setKeyMask(keysAt(0));
+		auto candidate = reference;
+
+		//Both machines as of the last check that passed, to bisect from
+		auto checkedReference = reference;
+		auto checkedCandidate = candidate;
+
+		unsigned long long done = 0;
+		while (done < instructions)
+		{
+			auto next = std::min<unsigned long long>(done + _interval, instructions);
+			advance(reference, _reference, done, next);
+			advance(candidate, _candidate, done, next);
+			_checks++;
+
+			if (MachineState::of(reference) != MachineState::of(candidate))
+			{
+				divergence = bisect(checkedReference, checkedCandidate, done, next);
+				return false;
+			}
+
+			checkedReference = reference;
+			checkedCandidate = candidate;
+			done = next;
+		}
+		return true;
+	}
+};
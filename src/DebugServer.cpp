@@ -0,0 +1,420 @@
+//GDB-remote-style stub for the debug engine, over a local TCP or Unix socket.
+
+#include "DebugServer.h"
+#include <cstdio>
+#include <cstdlib>
+
+namespace Chip8 {
+	namespace {
+		const char* HexDigits = "0123456789abcdef";
+
+		void appendHex(std::string& out, unsigned char value)
+		{
+			out += HexDigits[value >> 4];
+			out += HexDigits[value & 0xF];
+		}
+
+		//Parses "<hex>[,<hex>]" from the start of text; returns false on malformed input
+		bool parseHexPair(const std::string& text, unsigned long& first, unsigned long& second)
+		{
+			char* end = nullptr;
+			first = std::strtoul(text.c_str(), &end, 16);
+			if (end == text.c_str() || *end != ',')
+			{
+				return false;
+			}
+
+			const char* rest = end + 1;
+			second = std::strtoul(rest, &end, 16);
+			return end != rest;
+		}
+
+		//"v0".."vf" or "i"; returns Debugger::RegisterCount if unknown
+		unsigned char parseRegisterName(const std::string& name)
+		{
+			if (name == "i" || name == "I")
+			{
+				return Debugger::IndexRegister;
+			}
+			if (name.size() == 2 && (name[0] == 'v' || name[0] == 'V'))
+			{
+				char* end = nullptr;
+				auto value = std::strtoul(name.c_str() + 1, &end, 16);
+				if (*end == '\0' && value < 16)
+				{
+					return static_cast<unsigned char>(value);
+				}
+			}
+			return Debugger::RegisterCount;
+		}
+	};
+
+	DebugServer::DebugServer(Debugger& debugger, const std::string& address) :
+		_client(Net::InvalidHandle),
+		_debugger(debugger),
+		_input(),
+		_lastStop{ StopReason::Step, 0, 0 },
+		_listener(Net::listen(address)),
+		_noAck(false),
+		_running(false)
+	{
+	}
+
+	DebugServer::~DebugServer()
+	{
+		disconnect();
+		Net::close(_listener);
+	}
+
+	void DebugServer::disconnect()
+	{
+		if (_client != Net::InvalidHandle)
+		{
+			Net::close(_client);
+			_client = Net::InvalidHandle;
+		}
+		_debugger.clearAll();
+		_input.clear();
+		_noAck = false;
+		_running = false;
+	}
+
+	bool DebugServer::poll(unsigned int cycles)
+	{
+		if (_client == Net::InvalidHandle)
+		{
+			_client = Net::accept(_listener, 0);
+			if (_client == Net::InvalidHandle)
+			{
+				return false;
+			}
+			_lastStop = DebugStop{ StopReason::Step, _debugger.machine().programCounter(), 0 };
+		}
+
+		char buffer[1024];
+		while (_client != Net::InvalidHandle && Net::waitReadable(_client, 0))
+		{
+			auto received = Net::receive(_client, buffer, sizeof(buffer));
+			if (received <= 0)
+			{
+				disconnect();
+				return false;
+			}
+			_input.append(buffer, static_cast<size_t>(received));
+
+			size_t position = 0;
+			while (_client != Net::InvalidHandle && position < _input.size())
+			{
+				char c = _input[position];
+				if (c == '\x03')
+				{
+					//Ctrl-C: break into a running guest
+					position++;
+					if (_running)
+					{
+						_running = false;
+						reportStop(DebugStop{ StopReason::Interrupt, _debugger.machine().programCounter(), 0 });
+					}
+					continue;
+				}
+				if (c != '$')
+				{
+					//Acks and line noise
+					position++;
+					continue;
+				}
+
+				auto hash = _input.find('#', position);
+				if (hash == std::string::npos || hash + 2 >= _input.size())
+				{
+					break;
+				}
+
+				auto payload = _input.substr(position + 1, hash - position - 1);
+				unsigned int sum = 0;
+				for (auto byte : payload)
+				{
+					sum += static_cast<unsigned char>(byte);
+				}
+				auto expected = std::strtoul(_input.substr(hash + 1, 2).c_str(), nullptr, 16);
+				position = hash + 3;
+
+				if ((sum & 0xFF) != expected && !_noAck)
+				{
+					Net::sendAll(_client, "-", 1);
+					continue;
+				}
+				if (!_noAck)
+				{
+					Net::sendAll(_client, "+", 1);
+				}
+				handlePacket(payload);
+			}
+
+			if (_client == Net::InvalidHandle)
+			{
+				return false;
+			}
+			_input.erase(0, position);
+		}
+
+		if (_client == Net::InvalidHandle || !_running)
+		{
+			return false;
+		}
+
+		auto before = _debugger.machine().cycleCount();
+		auto stop = _debugger.run(cycles);
+		if (stop.reason != StopReason::None)
+		{
+			_running = false;
+			reportStop(stop);
+		}
+		return _debugger.machine().cycleCount() != before;
+	}
+
+	void DebugServer::handlePacket(const std::string& packet)
+	{
+		if (packet.empty())
+		{
+			sendPacket("");
+			return;
+		}
+
+		auto& machine = _debugger.machine();
+		auto arguments = packet.substr(1);
+		switch (packet[0])
+		{
+		case '?':
+			sendPacket(stopReply(_lastStop));
+			return;
+		case 'g':
+			sendPacket(readRegisters());
+			return;
+		case 'p':
+		{
+			auto reg = std::strtoul(arguments.c_str(), nullptr, 16);
+			std::string out;
+			if (reg < Debugger::RegisterCount)
+			{
+				auto value = _debugger.readRegister(static_cast<unsigned char>(reg));
+				if (reg == Debugger::IndexRegister)
+				{
+					appendHex(out, static_cast<unsigned char>(value >> 8));
+				}
+				appendHex(out, static_cast<unsigned char>(value));
+			}
+			else if (reg == 17)
+			{
+				appendHex(out, static_cast<unsigned char>(machine.programCounter() >> 8));
+				appendHex(out, static_cast<unsigned char>(machine.programCounter()));
+			}
+			else if (reg == 18)
+			{
+				appendHex(out, static_cast<unsigned char>(machine.stackPointer()));
+			}
+			else if (reg == 19)
+			{
+				appendHex(out, machine.delayTimer());
+			}
+			else if (reg == 20)
+			{
+				appendHex(out, machine.soundTimer());
+			}
+			sendPacket(out.empty() ? "E01" : out);
+			return;
+		}
+		case 'm':
+		{
+			unsigned long address = 0;
+			unsigned long length = 0;
+			if (!parseHexPair(arguments, address, length) || address >= Memory::Size)
+			{
+				sendPacket("E01");
+				return;
+			}
+
+			std::string out;
+			for (unsigned long i = address; i < address + length && i < Memory::Size; i++)
+			{
+				appendHex(out, machine.peek(static_cast<unsigned short>(i)));
+			}
+			sendPacket(out);
+			return;
+		}
+		case 'c':
+			_running = true;
+			return;
+		case 'n':
+		{
+			auto stop = _debugger.stepOver(0);
+			if (stop.reason == StopReason::None)
+			{
+				//A call: poll() keeps running until it returns
+				_running = true;
+				return;
+			}
+			reportStop(stop);
+			return;
+		}
+		case 's':
+			reportStop(_debugger.step());
+			return;
+		case 'Z':
+		case 'z':
+		{
+			unsigned long address = 0;
+			unsigned long length = 0;
+			if (packet.size() < 3 || !parseHexPair(packet.substr(3), address, length) || address >= Memory::Size)
+			{
+				sendPacket("E01");
+				return;
+			}
+
+			bool insert = packet[0] == 'Z';
+			auto target = static_cast<unsigned short>(address);
+			auto span = static_cast<unsigned short>(length > Memory::Size ? Memory::Size : length);
+			bool ok = false;
+			switch (packet[1])
+			{
+			case '0':
+			case '1':
+				ok = insert ? _debugger.setBreakpoint(target) : _debugger.clearBreakpoint(target);
+				break;
+			case '2':
+				ok = insert ? _debugger.setWatchpoint(target, span, Debugger::WatchWrite) : _debugger.clearWatchpoint(target, span, Debugger::WatchWrite);
+				break;
+			case '3':
+				ok = insert ? _debugger.setWatchpoint(target, span, Debugger::WatchRead) : _debugger.clearWatchpoint(target, span, Debugger::WatchRead);
+				break;
+			case '4':
+				ok = insert ? _debugger.setWatchpoint(target, span, Debugger::WatchAccess) : _debugger.clearWatchpoint(target, span, Debugger::WatchAccess);
+				break;
+			default:
+				sendPacket("");
+				return;
+			}
+			sendPacket(ok ? "OK" : "E01");
+			return;
+		}
+		case 'D':
+			sendPacket("OK");
+			disconnect();
+			return;
+		case 'k':
+			disconnect();
+			return;
+		}
+
+		if (packet.compare(0, 10, "qSupported") == 0)
+		{
+			sendPacket("PacketSize=1000;QStartNoAckMode+;swbreak+");
+		}
+		else if (packet == "QStartNoAckMode")
+		{
+			sendPacket("OK");
+			_noAck = true;
+		}
+		else if (packet.compare(0, 9, "qAttached") == 0)
+		{
+			sendPacket("1");
+		}
+		else if (packet.compare(0, 6, "qRcmd,") == 0)
+		{
+			std::string command;
+			for (size_t i = 6; i + 1 < packet.size(); i += 2)
+			{
+				command += static_cast<char>(std::strtoul(packet.substr(i, 2).c_str(), nullptr, 16));
+			}
+			sendPacket(monitor(command));
+		}
+		else
+		{
+			//Empty reply: not supported
+			sendPacket("");
+		}
+	}
+
+	std::string DebugServer::monitor(const std::string& command)
+	{
+		auto space = command.find(' ');
+		auto verb = command.substr(0, space);
+		auto reg = parseRegisterName(space == std::string::npos ? "" : command.substr(space + 1));
+
+		bool ok = false;
+		if (verb == "watch")
+		{
+			ok = _debugger.watchRegister(reg);
+		}
+		else if (verb == "unwatch")
+		{
+			ok = _debugger.unwatchRegister(reg);
+		}
+		return ok ? "OK" : "E01";
+	}
+
+	std::string DebugServer::readRegisters() const
+	{
+		const auto& machine = _debugger.machine();
+		std::string out;
+		for (unsigned char x = 0; x < 16; x++)
+		{
+			appendHex(out, machine.registerValue(x));
+		}
+		appendHex(out, static_cast<unsigned char>(machine.indexRegister() >> 8));
+		appendHex(out, static_cast<unsigned char>(machine.indexRegister()));
+		appendHex(out, static_cast<unsigned char>(machine.programCounter() >> 8));
+		appendHex(out, static_cast<unsigned char>(machine.programCounter()));
+		appendHex(out, static_cast<unsigned char>(machine.stackPointer()));
+		appendHex(out, machine.delayTimer());
+		appendHex(out, machine.soundTimer());
+		return out;
+	}
+
+	void DebugServer::reportStop(const DebugStop& stop)
+	{
+		_lastStop = stop;
+		sendPacket(stopReply(stop));
+	}
+
+	void DebugServer::sendPacket(const std::string& payload)
+	{
+		unsigned int sum = 0;
+		for (auto byte : payload)
+		{
+			sum += static_cast<unsigned char>(byte);
+		}
+
+		std::string framed = "$" + payload + "#";
+		appendHex(framed, static_cast<unsigned char>(sum));
+		Net::sendAll(_client, framed.data(), framed.size());
+	}
+
+	std::string DebugServer::stopReply(const DebugStop& stop) const
+	{
+		char address[8];
+		std::snprintf(address, sizeof(address), "%x", stop.address);
+
+		switch (stop.reason)
+		{
+		case StopReason::Breakpoint:
+			return "T05swbreak:;";
+		case StopReason::ReadWatch:
+			return std::string("T05rwatch:") + address + ";";
+		case StopReason::WriteWatch:
+			return std::string("T05watch:") + address + ";";
+		case StopReason::AccessWatch:
+			return std::string("T05awatch:") + address + ";";
+		case StopReason::RegisterWatch:
+		{
+			std::string reply = "T05chip8reg:";
+			appendHex(reply, stop.reg);
+			return reply + ";";
+		}
+		case StopReason::Interrupt:
+			return "T02";
+		default:
+			return "T05";
+		}
+	}
+};
@@ -0,0 +1,272 @@
+//Debug engine for a Machine: PC breakpoints, memory and register watchpoints, single-step and step-over.
+
+#include "Debugger.h"
+
+namespace Chip8 {
+	Debugger::Debugger(Machine& machine) :
+		_breakpoints(),
+		_machine(machine),
+		_registerWatches(0),
+		_resuming(true),
+		_stepOverActive(false),
+		_stepOverReturn(0),
+		_stepOverStack(0),
+		_watchpoints(),
+		_watchpointCount(0)
+	{
+	}
+
+	bool Debugger::setBreakpoint(unsigned short address)
+	{
+		if (address >= Memory::Size)
+		{
+			return false;
+		}
+		_breakpoints.set(address);
+		return true;
+	}
+
+	bool Debugger::clearBreakpoint(unsigned short address)
+	{
+		if (address >= Memory::Size)
+		{
+			return false;
+		}
+		_breakpoints.reset(address);
+		return true;
+	}
+
+	bool Debugger::setWatchpoint(unsigned short address, unsigned short length, WatchKind kind)
+	{
+		if (length == 0 || address >= Memory::Size || length > Memory::Size - address)
+		{
+			return false;
+		}
+
+		for (unsigned short i = 0; i < length; i++)
+		{
+			auto& watch = _watchpoints[address + i];
+			if (watch == 0)
+			{
+				_watchpointCount++;
+			}
+			watch |= static_cast<unsigned char>(kind);
+		}
+		return true;
+	}
+
+	bool Debugger::clearWatchpoint(unsigned short address, unsigned short length, WatchKind kind)
+	{
+		if (length == 0 || address >= Memory::Size || length > Memory::Size - address)
+		{
+			return false;
+		}
+
+		for (unsigned short i = 0; i < length; i++)
+		{
+			auto& watch = _watchpoints[address + i];
+			if (watch == 0)
+			{
+				continue;
+			}
+			watch &= static_cast<unsigned char>(~kind);
+			if (watch == 0)
+			{
+				_watchpointCount--;
+			}
+		}
+		return true;
+	}
+
+	bool Debugger::watchRegister(unsigned char reg)
+	{
+		if (reg >= RegisterCount)
+		{
+			return false;
+		}
+		_registerWatches |= 1u << reg;
+		return true;
+	}
+
+	bool Debugger::unwatchRegister(unsigned char reg)
+	{
+		if (reg >= RegisterCount)
+		{
+			return false;
+		}
+		_registerWatches &= ~(1u << reg);
+		return true;
+	}
+
+	void Debugger::clearAll()
+	{
+		_breakpoints.reset();
+		_watchpoints.fill(0);
+		_watchpointCount = 0;
+		_registerWatches = 0;
+		_resuming = true;
+		_stepOverActive = false;
+	}
+
+	unsigned short Debugger::registerOf(unsigned char reg) const
+	{
+		return reg == IndexRegister ? _machine.indexRegister() : _machine.registerValue(reg);
+	}
+
+	unsigned short Debugger::readRegister(unsigned char reg) const
+	{
+		return reg < RegisterCount ? registerOf(reg) : 0;
+	}
+
+	DebugStop Debugger::checkWatches(unsigned short address, unsigned short length, int kind) const
+	{
+		for (unsigned short i = 0; i < length; i++)
+		{
+			//Guest accesses past 0xFFF wrap to the bottom of memory
+			auto target = static_cast<unsigned short>((address + i) & 0xFFF);
+			auto watch = _watchpoints[target];
+			if ((watch & kind) == 0)
+			{
+				continue;
+			}
+
+			//Report the most specific kind the user asked for
+			auto reason = watch == WatchAccess ? StopReason::AccessWatch :
+				(kind == WatchRead ? StopReason::ReadWatch : StopReason::WriteWatch);
+			return DebugStop{ reason, target, 0 };
+		}
+		return DebugStop{ StopReason::None, 0, 0 };
+	}
+
+	DebugStop Debugger::executeOne()
+	{
+		auto pc = _machine.programCounter();
+		//Both fetch bytes wrap like the machine's own, so an opcode at 0xFFF ends at 0x000
+		auto opcode = static_cast<unsigned short>((_machine.peek(static_cast<unsigned short>(pc & 0xFFF)) << 8)
+			| _machine.peek(static_cast<unsigned short>((pc + 1) & 0xFFF)));
+
+		//Guest memory this instruction will touch, worked out before it moves I
+		unsigned short readLength = 0;
+		unsigned short writeLength = 0;
+		auto index = _machine.indexRegister();
+		auto x = static_cast<unsigned short>((opcode & 0x0F00) >> 8);
+		if (_watchpointCount != 0)
+		{
+			if ((opcode & 0xF000) == 0xD000)
+			{
+				readLength = opcode & 0x000F;
+			}
+			else if ((opcode & 0xF0FF) == 0xF065)
+			{
+				readLength = x + 1;
+			}
+			else if ((opcode & 0xF0FF) == 0xF055)
+			{
+				writeLength = x + 1;
+			}
+			else if ((opcode & 0xF0FF) == 0xF033)
+			{
+				writeLength = 3;
+			}
+		}
+
+		std::array<unsigned short, RegisterCount> before;
+		if (_registerWatches != 0)
+		{
+			for (unsigned char r = 0; r < RegisterCount; r++)
+			{
+				before[r] = registerOf(r);
+			}
+		}
+
+		_machine.emulateCycle();
+
+		if (readLength != 0)
+		{
+			auto stop = checkWatches(index, readLength, WatchRead);
+			if (stop.reason != StopReason::None)
+			{
+				return stop;
+			}
+		}
+		if (writeLength != 0)
+		{
+			auto stop = checkWatches(index, writeLength, WatchWrite);
+			if (stop.reason != StopReason::None)
+			{
+				return stop;
+			}
+		}
+
+		if (_registerWatches != 0)
+		{
+			for (unsigned char r = 0; r < RegisterCount; r++)
+			{
+				if ((_registerWatches & (1u << r)) != 0 && registerOf(r) != before[r])
+				{
+					return DebugStop{ StopReason::RegisterWatch, pc, r };
+				}
+			}
+		}
+		return DebugStop{ StopReason::None, 0, 0 };
+	}
+
+	DebugStop Debugger::step()
+	{
+		auto stop = executeOne();
+		if (stop.reason == StopReason::None)
+		{
+			stop.reason = StopReason::Step;
+			stop.address = _machine.programCounter();
+		}
+		return stopped(stop);
+	}
+
+	DebugStop Debugger::stepOver(unsigned int maxCycles)
+	{
+		auto pc = _machine.programCounter();
+		if ((_machine.peek(static_cast<unsigned short>(pc & 0xFFF)) & 0xF0) != 0x20)
+		{
+			return step();
+		}
+
+		//Run until the call returns to the next instruction at the same stack depth
+		_stepOverActive = true;
+		_stepOverReturn = static_cast<unsigned short>(pc + 2);
+		_stepOverStack = _machine.stackPointer();
+		return run(maxCycles);
+	}
+
+	DebugStop Debugger::run(unsigned int maxCycles)
+	{
+		for (unsigned int i = 0; i < maxCycles; i++)
+		{
+			auto pc = _machine.programCounter();
+			if (!_resuming && _breakpoints.test(pc & 0xFFF))
+			{
+				return stopped(DebugStop{ StopReason::Breakpoint, pc, 0 });
+			}
+			_resuming = false;
+
+			auto stop = executeOne();
+			if (stop.reason != StopReason::None)
+			{
+				return stopped(stop);
+			}
+
+			if (_stepOverActive && _machine.programCounter() == _stepOverReturn && _machine.stackPointer() == _stepOverStack)
+			{
+				return stopped(DebugStop{ StopReason::Step, _stepOverReturn, 0 });
+			}
+		}
+		return DebugStop{ StopReason::None, 0, 0 };
+	}
+
+	DebugStop Debugger::stopped(DebugStop stop)
+	{
+		//Continuing from here executes the instruction at the stop before breakpoints are checked again
+		_resuming = true;
+		_stepOverActive = false;
+		return stop;
+	}
+};
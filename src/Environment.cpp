@@ -0,0 +1,188 @@
+//Batched, headless Gym-style environment over many machines running the same ROM.
+
+#include "Environment.h"
+#include <stdexcept>
+#include <string>
+
+namespace Chip8 {
+	MemoryScoreReward::MemoryScoreReward(unsigned short address, unsigned short length, bool bcd) :
+		_address(address),
+		_bcd(bcd),
+		_doneAddress(0),
+		_hasDoneCondition(false),
+		_doneValue(0),
+		_length(length),
+		_lastScore(0)
+	{
+		if (length == 0 || length > 8 || address + length > Memory::Size)
+		{
+			throw std::invalid_argument("Score must be 1-8 bytes inside guest memory!");
+		}
+	}
+
+	void MemoryScoreReward::setDoneCondition(unsigned short address, unsigned char value)
+	{
+		if (address >= Memory::Size)
+		{
+			throw std::invalid_argument("Done condition must be inside guest memory!");
+		}
+		_doneAddress = address;
+		_doneValue = value;
+		_hasDoneCondition = true;
+	}
+
+	long long MemoryScoreReward::score(const Machine& machine) const
+	{
+		long long total = 0;
+		for (unsigned short i = 0; i < _length; i++)
+		{
+			unsigned char byte = machine.peek(static_cast<unsigned short>(_address + i));
+			total = _bcd ? (total * 10 + (byte % 10)) : ((total << 8) | byte);
+		}
+		return total;
+	}
+
+	std::unique_ptr<RewardExtractor> MemoryScoreReward::clone() const
+	{
+		return std::make_unique<MemoryScoreReward>(*this);
+	}
+
+	void MemoryScoreReward::reset(const Machine& machine)
+	{
+		_lastScore = score(machine);
+	}
+
+	float MemoryScoreReward::reward(const Machine& machine, bool& done)
+	{
+		auto current = score(machine);
+		auto delta = current - _lastScore;
+		_lastScore = current;
+
+		if (_hasDoneCondition && machine.peek(_doneAddress) == _doneValue)
+		{
+			done = true;
+		}
+		return static_cast<float>(delta);
+	}
+
+	CallbackReward::CallbackReward(Callback callback) :
+		_callback(std::move(callback))
+	{
+	}
+
+	std::unique_ptr<RewardExtractor> CallbackReward::clone() const
+	{
+		return std::make_unique<CallbackReward>(*this);
+	}
+
+	void CallbackReward::reset(const Machine&)
+	{
+	}
+
+	float CallbackReward::reward(const Machine& machine, bool& done)
+	{
+		return _callback(machine, done);
+	}
+
+	Environment::Environment(const unsigned char* rom, size_t romSize, size_t batchSize, unsigned int frameSkip, unsigned int seed) :
+		_episodeFrames(batchSize, 0),
+		_episodes(batchSize, 0),
+		_frameSkip(frameSkip == 0 ? 1 : frameSkip),
+		_initial(),
+		_machines(),
+		_maxEpisodeFrames(0),
+		_needsReset(batchSize, 1),
+		_reward(),
+		_rewards(batchSize),
+		_seed(seed)
+	{
+		if (batchSize == 0)
+		{
+			throw std::invalid_argument("Batch size must be at least 1!");
+		}
+
+		//Every machine shares the loaded ROM image copy-on-write
+		_initial.loadProgram(rom, romSize);
+		_machines.assign(batchSize, _initial);
+	}
+
+	void Environment::setMaxEpisodeFrames(unsigned long long frames)
+	{
+		_maxEpisodeFrames = frames;
+	}
+
+	void Environment::setRewardExtractor(std::unique_ptr<RewardExtractor> reward)
+	{
+		_reward = std::move(reward);
+		for (size_t i = 0; i < _machines.size(); i++)
+		{
+			_rewards[i] = _reward ? _reward->clone() : nullptr;
+			if (_rewards[i])
+			{
+				_rewards[i]->reset(_machines[i]);
+			}
+		}
+	}
+
+	void Environment::resetOne(size_t index)
+	{
+		auto& machine = _machines[index];
+		machine = _initial;
+
+		//Distinct, reproducible random stream per machine and episode
+		machine.seed(_seed * 0x9E3779B1u + static_cast<unsigned int>(index) * 0x85EBCA6Bu + _episodes[index] * 0xC2B2AE35u);
+		_episodes[index]++;
+		_episodeFrames[index] = 0;
+		_needsReset[index] = 0;
+
+		if (_rewards[index])
+		{
+			_rewards[index]->reset(machine);
+		}
+	}
+
+	void Environment::reset(unsigned char* observations)
+	{
+		for (size_t i = 0; i < _machines.size(); i++)
+		{
+			resetOne(i);
+			_machines[i].packFramebuffer(observations + i * observationSize());
+		}
+	}
+
+	void Environment::step(const unsigned short* actions, unsigned char* observations, float* rewards, unsigned char* dones)
+	{
+		for (size_t i = 0; i < _machines.size(); i++)
+		{
+			if (_needsReset[i])
+			{
+				resetOne(i);
+			}
+
+			auto& machine = _machines[i];
+			machine.setKeyMask(actions[i]);
+			machine.runFrames(_frameSkip, CyclesPerFrame);
+			_episodeFrames[i] += _frameSkip;
+
+			bool done = false;
+			rewards[i] = _rewards[i] ? _rewards[i]->reward(machine, done) : 0.0f;
+			if (_maxEpisodeFrames != 0 && _episodeFrames[i] >= _maxEpisodeFrames)
+			{
+				done = true;
+			}
+
+			dones[i] = done ? 1 : 0;
+			_needsReset[i] = dones[i];
+			machine.packFramebuffer(observations + i * observationSize());
+		}
+	}
+
+	const Machine& Environment::machine(size_t index) const
+	{
+		if (index >= _machines.size())
+		{
+			throw std::out_of_range("No machine " + std::to_string(index) + " in a batch of " + std::to_string(_machines.size()) + "!");
+		}
+		return _machines[index];
+	}
+};
@@ -0,0 +1,289 @@
+//Records presented frames to disk as a Y4M video or a numbered PNG sequence.
+
+#include "FrameCapture.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace Chip8 {
+	namespace {
+		const unsigned int Width = 64;
+		const unsigned int Height = 32;
+
+		unsigned int crc32(const unsigned char* data, size_t size, unsigned int crc = 0)
+		{
+			static const std::array<unsigned int, 256> table = []
+			{
+				std::array<unsigned int, 256> entries;
+				for (unsigned int n = 0; n < 256; n++)
+				{
+					unsigned int c = n;
+					for (int k = 0; k < 8; k++)
+					{
+						c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+					}
+					entries[n] = c;
+				}
+				return entries;
+			}();
+
+			crc = ~crc;
+			for (size_t i = 0; i < size; i++)
+			{
+				crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+			}
+			return ~crc;
+		}
+
+		void appendBigEndian(std::vector<unsigned char>& out, unsigned int value)
+		{
+			out.push_back(static_cast<unsigned char>(value >> 24));
+			out.push_back(static_cast<unsigned char>(value >> 16));
+			out.push_back(static_cast<unsigned char>(value >> 8));
+			out.push_back(static_cast<unsigned char>(value));
+		}
+
+		void appendChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+		{
+			appendBigEndian(out, static_cast<unsigned int>(data.size()));
+			auto start = out.size();
+			out.insert(out.end(), type, type + 4);
+			out.insert(out.end(), data.begin(), data.end());
+			appendBigEndian(out, crc32(out.data() + start, out.size() - start));
+		}
+	};
+
+	FrameCapture::FrameCapture(const std::string& path, unsigned int scale) :
+		_dropped(0),
+		_format(Format::Png),
+		_frames(0),
+		_head(0),
+		_hasLast(false),
+		_last(),
+		_path(path),
+		_queue(QueueSize),
+		_scale(scale == 0 ? 1 : scale),
+		_stopping(false),
+		_submitted(0),
+		_tail(0),
+		_written(0)
+	{
+		auto extension = path.size() >= 4 ? path.substr(path.size() - 4) : std::string();
+		if (extension == ".y4m" || extension == ".Y4M")
+		{
+			_format = Format::Y4M;
+			_file.open(path, std::ios::binary);
+			if (!_file)
+			{
+				throw std::runtime_error("Could not open capture output file!");
+			}
+
+			//Full-range greyscale; ffmpeg and most players read Cmono directly
+			_file << "YUV4MPEG2 W" << Width * _scale << " H" << Height * _scale << " F60:1 Ip A1:1 Cmono\n";
+		}
+		else if (extension == ".png" || extension == ".PNG")
+		{
+			_path = path.substr(0, path.size() - 4);
+		}
+
+		_encoder = std::thread(&FrameCapture::encodeLoop, this);
+	}
+
+	FrameCapture::~FrameCapture()
+	{
+		_stopping.store(true, std::memory_order_release);
+		_encoder.join();
+	}
+
+	void FrameCapture::submit(const Machine& machine)
+	{
+		auto frame = _frames++;
+		_submitted.store(_frames, std::memory_order_relaxed);
+
+		std::array<unsigned char, Machine::PackedFramebufferSize> pixels;
+		machine.packFramebuffer(pixels.data());
+		if (_hasLast && pixels == _last)
+		{
+			return;
+		}
+
+		auto head = _head.load(std::memory_order_relaxed);
+		if (head - _tail.load(std::memory_order_acquire) >= QueueSize)
+		{
+			//Encoder is behind; keep the emulation loop moving. _last is left alone so the
+			//next frame with this picture is tried again.
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		auto& slot = _queue[head % QueueSize];
+		slot.frame = frame;
+		slot.pixels = pixels;
+		_head.store(head + 1, std::memory_order_release);
+
+		_last = pixels;
+		_hasLast = true;
+	}
+
+	void FrameCapture::repeat(unsigned long long frames)
+	{
+		_frames += frames;
+		_submitted.store(_frames, std::memory_order_relaxed);
+	}
+
+	void FrameCapture::expand(const Slot& slot, std::vector<unsigned char>& luma) const
+	{
+		auto width = Width * _scale;
+		luma.resize(static_cast<size_t>(width) * Height * _scale);
+		for (unsigned int y = 0; y < Height * _scale; y++)
+		{
+			auto row = &slot.pixels[(y / _scale) * (Width / 8)];
+			for (unsigned int x = 0; x < width; x++)
+			{
+				auto column = x / _scale;
+				bool lit = (row[column / 8] & (0x80 >> (column % 8))) != 0;
+				luma[static_cast<size_t>(y) * width + x] = lit ? 255 : 0;
+			}
+		}
+	}
+
+	void FrameCapture::writeY4m(const std::vector<unsigned char>& frame, unsigned long long count)
+	{
+		for (unsigned long long i = 0; i < count; i++)
+		{
+			_file << "FRAME\n";
+			_file.write(reinterpret_cast<const char*>(frame.data()), static_cast<std::streamsize>(frame.size()));
+		}
+	}
+
+	void FrameCapture::writePng(const Slot& slot)
+	{
+		std::vector<unsigned char> luma;
+		expand(slot, luma);
+
+		//1-bit greyscale rows, each behind a "no filter" byte
+		auto width = Width * _scale;
+		auto height = Height * _scale;
+		auto stride = (width + 7) / 8;
+		std::vector<unsigned char> raw;
+		raw.reserve(static_cast<size_t>(stride + 1) * height);
+		for (unsigned int y = 0; y < height; y++)
+		{
+			raw.push_back(0);
+			for (unsigned int x = 0; x < width; x += 8)
+			{
+				unsigned char bits = 0;
+				for (unsigned int b = 0; b < 8 && x + b < width; b++)
+				{
+					if (luma[static_cast<size_t>(y) * width + x + b] != 0)
+					{
+						bits |= static_cast<unsigned char>(0x80 >> b);
+					}
+				}
+				raw.push_back(bits);
+			}
+		}
+
+		//zlib stream of stored (uncompressed) deflate blocks; 1-bit frames are small enough as they are
+		std::vector<unsigned char> zlib = { 0x78, 0x01 };
+		size_t offset = 0;
+		do
+		{
+			auto length = raw.size() - offset < 65535 ? raw.size() - offset : 65535;
+			bool final = offset + length == raw.size();
+			zlib.push_back(final ? 1 : 0);
+			zlib.push_back(static_cast<unsigned char>(length));
+			zlib.push_back(static_cast<unsigned char>(length >> 8));
+			zlib.push_back(static_cast<unsigned char>(~length));
+			zlib.push_back(static_cast<unsigned char>(~length >> 8));
+			zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+			offset += length;
+		} while (offset < raw.size());
+
+		unsigned int a = 1;
+		unsigned int b = 0;
+		for (auto byte : raw)
+		{
+			a = (a + byte) % 65521;
+			b = (b + a) % 65521;
+		}
+		appendBigEndian(zlib, (b << 16) | a);
+
+		std::vector<unsigned char> header;
+		appendBigEndian(header, width);
+		appendBigEndian(header, height);
+		header.push_back(1);		//Bit depth
+		header.push_back(0);		//Greyscale
+		header.push_back(0);		//Deflate
+		header.push_back(0);		//Adaptive filtering
+		header.push_back(0);		//Not interlaced
+
+		std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		appendChunk(png, "IHDR", header);
+		appendChunk(png, "IDAT", zlib);
+		appendChunk(png, "IEND", std::vector<unsigned char>());
+
+		char number[32];
+		std::snprintf(number, sizeof(number), "_%06llu.png", slot.frame);
+		std::ofstream file(_path + number, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+		if (file)
+		{
+			_written.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	void FrameCapture::encodeLoop()
+	{
+		//Y4M: frames between two distinct ones repeat the earlier picture (blank before the first)
+		std::vector<unsigned char> previous(static_cast<size_t>(Width) * Height * _scale * _scale, 0);
+		std::vector<unsigned char> luma;
+		unsigned long long emitted = 0;
+
+		while (true)
+		{
+			auto tail = _tail.load(std::memory_order_relaxed);
+			if (tail == _head.load(std::memory_order_acquire))
+			{
+				if (_stopping.load(std::memory_order_acquire))
+				{
+					//Anything submitted before the stop flag is visible now
+					if (tail == _head.load(std::memory_order_acquire))
+					{
+						break;
+					}
+					continue;
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+				continue;
+			}
+
+			const auto& slot = _queue[tail % QueueSize];
+			if (_format == Format::Y4M)
+			{
+				writeY4m(previous, slot.frame - emitted);
+				expand(slot, luma);
+				writeY4m(luma, 1);
+				emitted = slot.frame + 1;
+				previous.swap(luma);
+				_written.fetch_add(1, std::memory_order_relaxed);
+			}
+			else
+			{
+				writePng(slot);
+			}
+			_tail.store(tail + 1, std::memory_order_release);
+		}
+
+		if (_format == Format::Y4M)
+		{
+			auto total = _submitted.load(std::memory_order_relaxed);
+			if (total > emitted)
+			{
+				writeY4m(previous, total - emitted);
+			}
+			_file.flush();
+		}
+	}
+};
@@ -0,0 +1,59 @@
+//Power-aware host frame pacing - lets the frontend sleep while the guest is idle
+//and catch emulated time back up when it wakes.
+
+#include "FramePacer.h"
+#include <algorithm>
+#include <thread>
+
+namespace Chip8 {
+	FramePacer::FramePacer(unsigned int framesPerSecond, std::chrono::milliseconds maxSleep, unsigned int maxCatchUp) :
+		_frameTime(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds(1)) / framesPerSecond),
+		_last(),
+		_maxSleep(maxSleep),
+		_maxCatchUp(maxCatchUp),
+		_owed(0),
+		_started(false),
+		_sleeps(0)
+	{
+	}
+
+	unsigned int FramePacer::framesDue()
+	{
+		auto now = std::chrono::steady_clock::now();
+		if (!_started)
+		{
+			_started = true;
+			_last = now;
+			return 1;
+		}
+
+		_owed += now - _last;
+		_last = now;
+
+		auto frames = static_cast<unsigned long long>(_owed / _frameTime);
+		_owed -= _frameTime * frames;
+
+		//Don't try to make up for a stall (debugger, window drag) all at once
+		return static_cast<unsigned int>(std::min<unsigned long long>(frames, _maxCatchUp));
+	}
+
+	bool FramePacer::sleepIdle(unsigned long long idleFrames)
+	{
+		//Leave the current frame alone; only whole idle frames after it are worth sleeping through
+		if (idleFrames <= 1)
+		{
+			return false;
+		}
+
+		//Never more than one frame: nothing wakes the sleep, so a key pressed meanwhile waits it out
+		auto duration = std::min(_frameTime, _maxSleep);
+		if (duration <= std::chrono::steady_clock::duration::zero())
+		{
+			return false;
+		}
+
+		std::this_thread::sleep_for(duration);
+		_sleeps++;
+		return true;
+	}
+};
@@ -0,0 +1,174 @@
+//Input-to-photon latency tracking and synthetic key input.
+
+#include "LatencyTracker.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace Chip8 {
+	LatencyTracker::LatencyTracker(bool wallClock) :
+		_drawnAt(0),
+		_observedAt(0),
+		_key(0),
+		_sampledAt(0),
+		_state(State::Idle),
+		_superseded(0),
+		_wallClock(wallClock)
+	{
+	}
+
+	void LatencyTracker::keyChanged(unsigned short before, unsigned short after, unsigned long long cycle)
+	{
+		unsigned short changed = before ^ after;
+		if (changed == 0)
+		{
+			return;
+		}
+
+		if (_state != State::Idle)
+		{
+			_superseded++;
+		}
+
+		unsigned char key = 0;
+		while ((changed & (1u << key)) == 0)
+		{
+			key++;
+		}
+
+		_key = key;
+		_sampledAt = cycle;
+		if (_wallClock)
+		{
+			_sampledWall = std::chrono::steady_clock::now();
+		}
+		_state = State::Sampled;
+	}
+
+	void LatencyTracker::observed(unsigned char key, unsigned long long cycle)
+	{
+		if (_state == State::Sampled && (key == _key || key == AnyKey))
+		{
+			_observedAt = cycle;
+			_state = State::Observed;
+		}
+	}
+
+	void LatencyTracker::drawn(unsigned long long cycle)
+	{
+		if (_state == State::Observed)
+		{
+			_drawnAt = cycle;
+			_state = State::Drawn;
+		}
+	}
+
+	void LatencyTracker::presented(unsigned long long cycle)
+	{
+		if (_state != State::Drawn)
+		{
+			return;
+		}
+
+		_samples[Poll].push_back(static_cast<unsigned int>(_observedAt - _sampledAt));
+		_samples[Draw].push_back(static_cast<unsigned int>(_drawnAt - _observedAt));
+		_samples[Present].push_back(static_cast<unsigned int>(cycle - _drawnAt));
+		_samples[Total].push_back(static_cast<unsigned int>(cycle - _sampledAt));
+		if (_wallClock)
+		{
+			_wall.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _sampledWall).count());
+		}
+		_state = State::Idle;
+	}
+
+	std::string LatencyTracker::report(double cyclesPerSecond) const
+	{
+		static const char* names[] = { "poll", "draw", "present", "total" };
+		auto toMs = 1000.0 / cyclesPerSecond;
+
+		auto percentile = [](std::vector<double> values, double p)
+		{
+			if (values.empty())
+			{
+				return 0.0;
+			}
+			std::sort(values.begin(), values.end());
+			auto rank = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+			return values[rank];
+		};
+
+		std::ostringstream out;
+		out << std::fixed << std::setprecision(1);
+		out << "Input latency over " << completed() << " key transitions (" << _superseded
+			<< " superseded before reaching the screen), emulated ms at " << cyclesPerSecond << "Hz:\n";
+		out << "  stage        p50      p90      p99      max\n";
+
+		std::array<std::vector<double>, StageCount> milliseconds;
+		for (int stage = 0; stage < StageCount; stage++)
+		{
+			for (auto cycles : _samples[stage])
+			{
+				milliseconds[stage].push_back(cycles * toMs);
+			}
+		}
+
+		auto row = [&](const char* name, const std::vector<double>& values)
+		{
+			out << "  " << std::left << std::setw(9) << name << std::right
+				<< std::setw(8) << percentile(values, 0.5) << std::setw(9) << percentile(values, 0.9)
+				<< std::setw(9) << percentile(values, 0.99) << std::setw(9) << percentile(values, 1.0) << "\n";
+		};
+		for (int stage = 0; stage < StageCount; stage++)
+		{
+			row(names[stage], milliseconds[stage]);
+		}
+		if (_wallClock)
+		{
+			row("wall", _wall);
+		}
+
+		//Total latency histogram, buckets in milliseconds
+		static const double bounds[] = { 2, 4, 8, 16, 33, 50, 67, 100, 150, 250, 500 };
+		std::array<size_t, sizeof(bounds) / sizeof(bounds[0]) + 1> counts = {};
+		for (auto value : milliseconds[Total])
+		{
+			auto bucket = std::lower_bound(std::begin(bounds), std::end(bounds), value) - std::begin(bounds);
+			counts[bucket]++;
+		}
+
+		out << "  total histogram:";
+		for (size_t i = 0; i < counts.size(); i++)
+		{
+			out << (i < counts.size() - 1 ? " <=" : " >") << std::setprecision(0)
+				<< bounds[i < counts.size() - 1 ? i : i - 1] << "ms:" << counts[i];
+		}
+		out << "\n";
+		return out.str();
+	}
+
+	InputInjector::InputInjector(unsigned short mask, unsigned int periodFrames, unsigned int seed) :
+		_down(false),
+		_mask(mask),
+		_period(periodFrames == 0 ? 1 : periodFrames),
+		_state(seed == 0 ? 1 : seed)
+	{
+	}
+
+	bool InputInjector::due(unsigned long long frame, unsigned int cyclesPerFrame, unsigned int& cycle, unsigned short& keys)
+	{
+		if (frame % _period != _period - 1)
+		{
+			return false;
+		}
+
+		//xorshift32, as in the machine's own RNG
+		_state ^= _state << 13;
+		_state ^= _state >> 17;
+		_state ^= _state << 5;
+
+		cycle = cyclesPerFrame == 0 ? 0 : _state % cyclesPerFrame;
+		_down = !_down;
+		keys = _down ? _mask : 0;
+		return true;
+	}
+};
@@ -0,0 +1,1108 @@
+//Ken Johnson (capnkenny) - 4/14/2020
+//Based off of the CHIP-8 tutorial from multigesture.net
+
+#include "Machine.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+//Bounds-checked build (for fuzzing): out of range guest accesses raise a MachineFault
+//before anything outside the machine is touched
+#ifdef CHIP8_BOUNDS_CHECKED
+#define CHECK_GUEST(condition, kind, address) if (!(condition)) { fault(kind, address); }
+#else
+#define CHECK_GUEST(condition, kind, address)
+#endif
+
+namespace Chip8 {
+	namespace {
+		std::string describeFault(FaultKind kind, unsigned short programCounter, unsigned short opcode, unsigned int address)
+		{
+			static const char* names[] = { "Fetch past end of memory", "Stack overflow", "Stack underflow",
+				"Read past end of memory", "Write past end of memory", "Key index out of range" };
+
+			std::ostringstream out;
+			out << std::hex << std::uppercase << names[static_cast<int>(kind)] << " at PC 0x" << programCounter
+				<< " (opcode 0x" << opcode << ", " << (kind == FaultKind::KeyIndex ? "key 0x" :
+				(kind == FaultKind::StackOverflow || kind == FaultKind::StackUnderflow) ? "depth 0x" : "address 0x")
+				<< address << ")";
+			return out.str();
+		}
+	};
+
+	MachineFault::MachineFault(FaultKind kind, unsigned short programCounter, unsigned short opcode, unsigned int address) :
+		std::runtime_error(describeFault(kind, programCounter, opcode, address)),
+		kind(kind),
+		programCounter(programCounter),
+		opcode(opcode),
+		address(address)
+	{
+	}
+
+	Machine::Machine() :
+		_cycleCount(0),
+		_delayTimer(0),
+		_drawCount(0),
+		_index(0),
+		_latency(nullptr),
+		_opcode(0),
+		_programCounter(0x200),
+		_profiler(nullptr),
+		_randomState(0x2545F491),
+		_romHash(0),
+		_soundTimer(0),
+		_sp(0),
+		_memory(fontImage()),
+		_stack(std::array<unsigned short, 16>()),
+		_vRegister(std::array<unsigned char, 16>()),
+		drawFlag(false),
+		gfx(std::array<unsigned char, 2048>()),
+		key(std::array<unsigned char, 16>())
+	{
+	}
+
+	std::shared_ptr<const Memory::Image> Machine::fontImage()
+	{
+		//Every machine starts from the same zeroed memory with the font set at 0x000
+		static const std::shared_ptr<const Memory::Image> image = []
+		{
+			auto blank = std::make_shared<Memory::Image>();
+			std::copy(Core::Fontset.begin(), Core::Fontset.end(), blank->begin());
+			return blank;
+		}();
+		return image;
+	}
+
+	bool Machine::cycleTimers()
+	{
+		bool expired = false;
+
+		//Decrement timers if it's been set
+		if (_delayTimer > 0)
+		{
+			_delayTimer--;
+		}
+		if (_soundTimer > 0)
+		{
+			if (_soundTimer == 1)
+			{
+				expired = true;
+			}
+			_soundTimer--;
+		}
+
+		return expired;
+	}
+
+	void Machine::emulateCycle()
+	{
+		//Fetch
+		CHECK_GUEST(_programCounter + 1u < Memory::Size, FaultKind::Fetch, _programCounter + 1u);
+		unsigned short nextCounter = _programCounter + 1;
+		_opcode = (_memory[_programCounter] << 8) | _memory[nextCounter];
+		_cycleCount++;
+
+		if (_profiler)
+		{
+			_profiler->countCycle();
+		}
+
+		//Decode and Execute
+		switch ((_opcode & 0xF000) >> 12)
+		{
+		case 0x0:
+		{
+			switch (_opcode & 0x000F)
+			{
+			case 0x0000: op00E0(); break;
+			case 0x000E: op00EE(); break;
+			}
+			break;
+		}
+		case 0x1:
+		{
+			op1nnn();
+			break;
+		}
+		case 0x2:
+		{
+			op2nnn();
+			break;
+		}
+		case 0x3:
+		{
+			op3xkk();
+			break;
+		}
+		case 0x4:
+		{
+			op4xkk();
+			break;
+		}
+		case 0x5:
+		{
+			op5xy0();
+			break;
+		}
+		case 0x6:
+		{
+			op6xkk();
+			break;
+		}
+		case 0x7:
+		{
+			op7xkk();
+			break;
+		}
+		case 0x8:
+		{
+			switch (_opcode & 0x000F)
+			{
+			case 0x0: op8xy0(); break;
+			case 0x0001: op8xy1(); break;
+			case 0x0002: op8xy2(); break;
+			case 0x0003: op8xy3(); break;
+			case 0x0004: op8xy4(); break;
+			case 0x0005: op8xy5(); break;
+			case 0x0006: op8xy6(); break;
+			case 0x0007: op8xy7(); break;
+			case 0x000E: op8xyE(); break;
+			}
+			break;
+		}
+		case 0x9:
+		{
+			op9xy0();
+			break;
+		}
+		case 0xA:
+		{
+			opAnnn();
+			break;
+		}
+		case 0xB:
+		{
+			opBnnn();
+			break;
+		}
+		case 0xC:
+		{
+			opCxkk();
+			break;
+		}
+		case 0xD:
+		{
+			opDxyn();
+			break;
+		}
+		case 0xE:
+		{
+			switch (_opcode & 0x00FF)
+			{
+			case 0x009E:opEx9E(); break;
+			case 0x00A1:opExA1(); break;
+			}
+			break;
+		}
+		case 0xF:
+		{
+			switch (_opcode & 0x00FF)
+			{
+			case 0x0007: opFx07(); break;
+			case 0x000A: opFx0A(); break;
+			case 0x0015: opFx15(); break;
+			case 0x0018: opFx18(); break;
+			case 0x001E: opFx1E(); break;
+			case 0x0029: opFx29(); break;
+			case 0x0033: opFx33(); break;
+			case 0x0055: opFx55(); break;
+			case 0x0065: opFx65(); break;
+			}
+			break;
+		}
+		}
+	}
+
+	size_t Machine::loadProgram(const unsigned char* data, size_t size)
+	{
+		// Copy buffer to Chip8 memory
+		if ((4096 - 512) <= size)
+		{
+			throw std::runtime_error("ROM too big for memory!");
+		}
+
+		auto image = std::make_shared<Memory::Image>(_memory.snapshot());
+		std::copy(data, data + size, image->begin() + 512);
+		_memory.reset(image);
+
+		_romHash = 0xCBF29CE484222325ull;
+		for (size_t i = 0; i < size; i++)
+		{
+			_romHash = (_romHash ^ data[i]) * 0x100000001B3ull;
+		}
+		return size;
+	}
+
+	size_t Machine::loadProgram(const std::string& fileName)
+	{
+		if (fileName == "")
+		{
+			throw std::runtime_error("No ROM provided!");
+		}
+
+		std::ifstream file(fileName, std::ios::binary);
+		if (!file)
+		{
+			throw std::runtime_error("Could not open file!");
+		}
+
+		std::vector<unsigned char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		return loadProgram(buffer.data(), buffer.size());
+	}
+
+	void Machine::seed(unsigned int seed)
+	{
+		//xorshift can't leave the all-zero state
+		_randomState = seed != 0 ? seed : 0x2545F491;
+	}
+
+	unsigned char Machine::nextRandom()
+	{
+		//xorshift32, kept per machine so clones and replays see the same sequence
+		_randomState = Core::nextRandom(_randomState);
+		return static_cast<unsigned char>(_randomState % 0xFF);
+	}
+
+	void Machine::setLatencyTracker(LatencyTracker* latency)
+	{
+		_latency = latency;
+	}
+
+	void Machine::setProfiler(Profiler* profiler)
+	{
+		_profiler = profiler;
+	}
+
+	unsigned short Machine::keyMask() const
+	{
+		unsigned short mask = 0;
+		for (unsigned short i = 0; i < 16; i++)
+		{
+			if (key[i] != 0)
+			{
+				mask |= static_cast<unsigned short>(1u << i);
+			}
+		}
+		return mask;
+	}
+
+	void Machine::setKeyMask(unsigned short mask)
+	{
+		for (unsigned short i = 0; i < 16; i++)
+		{
+			key[i] = static_cast<unsigned char>((mask >> i) & 1u);
+		}
+	}
+
+	void Machine::packFramebuffer(unsigned char* out) const
+	{
+		for (size_t byte = 0; byte < PackedFramebufferSize; byte++)
+		{
+			const unsigned char* pixels = gfx.data() + byte * 8;
+			out[byte] = static_cast<unsigned char>((pixels[0] << 7) | (pixels[1] << 6) | (pixels[2] << 5) | (pixels[3] << 4)
+				| (pixels[4] << 3) | (pixels[5] << 2) | (pixels[6] << 1) | pixels[7]);
+		}
+	}
+
+	unsigned long long Machine::framebufferHash() const
+	{
+		std::array<unsigned char, PackedFramebufferSize> packed;
+		packFramebuffer(packed.data());
+
+		unsigned long long hash = 0xCBF29CE484222325ull;
+		for (auto byte : packed)
+		{
+			hash = (hash ^ byte) * 0x100000001B3ull;
+		}
+		return hash;
+	}
+
+	unsigned long long Machine::memoryHash() const
+	{
+		unsigned long long hash = 0xCBF29CE484222325ull;
+		for (unsigned int address = 0; address < Memory::Size; address++)
+		{
+			hash = (hash ^ _memory[static_cast<unsigned short>(address)]) * 0x100000001B3ull;
+		}
+		return hash;
+	}
+
+	Core::State Machine::coreState() const
+	{
+		Core::State state;
+		for (unsigned int address = 0; address < Memory::Size; address++)
+		{
+			state.memory[address] = _memory[static_cast<unsigned short>(address)];
+		}
+		state.gfx = gfx;
+		state.stack = _stack;
+		state.registers = _vRegister;
+		state.keys = keyMask();
+		state.index = _index;
+		state.programCounter = _programCounter;
+		state.sp = _sp;
+		state.delayTimer = _delayTimer;
+		state.soundTimer = _soundTimer;
+		state.randomState = _randomState;
+		state.cycles = _cycleCount;
+		return state;
+	}
+
+	void Machine::loadCoreState(const Core::State& state)
+	{
+		for (unsigned int address = 0; address < Memory::Size; address++)
+		{
+			if (state.memory[address] != _memory[static_cast<unsigned short>(address)])
+			{
+				_memory.write(static_cast<unsigned short>(address), state.memory[address]);
+			}
+		}
+		if (state.gfx != gfx)
+		{
+			gfx = state.gfx;
+			drawFlag = true;
+		}
+		_stack = state.stack;
+		_vRegister = state.registers;
+		setKeyMask(state.keys);
+		_index = state.index;
+		_programCounter = state.programCounter;
+		_sp = state.sp;
+		_delayTimer = state.delayTimer;
+		_soundTimer = state.soundTimer;
+		_randomState = state.randomState;
+		_cycleCount = state.cycles;
+	}
+
+	Machine Machine::fork() const
+	{
+		Machine clone(*this);
+		clone._latency = nullptr;
+		clone._profiler = nullptr;
+		return clone;
+	}
+
+	void Machine::fault(FaultKind kind, unsigned int address) const
+	{
+		throw MachineFault(kind, _programCounter, _opcode, address);
+	}
+
+	unsigned short Machine::opcodeAt(unsigned short address) const
+	{
+		//Out of range reads never match an idle pattern
+		if (address >= 0xFFF)
+		{
+			return 0;
+		}
+		return static_cast<unsigned short>((_memory[address] << 8) | _memory[address + 1]);
+	}
+
+	IdleLoop Machine::detectIdleLoop(unsigned short* head, unsigned short* length) const
+	{
+		//The program counter may sit anywhere inside the loop body, so try each possible loop start
+		for (unsigned short back = 0; back <= 4 && back <= _programCounter; back += 2)
+		{
+			unsigned short start = _programCounter - back;
+			unsigned short first = opcodeAt(start);
+			unsigned short jumpBack = 0x1000 | start;
+			IdleLoop loop = IdleLoop::None;
+			unsigned short size = 0;
+
+			if (first == jumpBack)
+			{
+				loop = IdleLoop::Halt;
+				size = 1;
+			}
+			else if ((first & 0xF0FF) == 0xF00A)
+			{
+				loop = IdleLoop::KeyWait;
+				size = 1;
+			}
+			else if (((first & 0xF0FF) == 0xE09E || (first & 0xF0FF) == 0xE0A1) && opcodeAt(start + 2) == jumpBack)
+			{
+				loop = IdleLoop::KeyPoll;
+				size = 2;
+			}
+			else if ((first & 0xF0FF) == 0xF007 && (opcodeAt(start + 2) & 0xFF00) == (0x3000 | (first & 0x0F00))
+				&& opcodeAt(start + 4) == jumpBack)
+			{
+				loop = IdleLoop::DelayWait;
+				size = 3;
+			}
+
+			if (loop != IdleLoop::None && back < size * 2)
+			{
+				if (head)
+				{
+					*head = start;
+				}
+				if (length)
+				{
+					*length = size;
+				}
+				return loop;
+			}
+		}
+
+		return IdleLoop::None;
+	}
+
+	bool Machine::isIdleIteration(IdleLoop loop, unsigned short head) const
+	{
+		//True if running the loop once more from head would not leave it,
+		//given the current key state and delay timer
+		unsigned short first = opcodeAt(head);
+		unsigned char x = static_cast<unsigned char>((first & 0x0F00) >> 8);
+
+		switch (loop)
+		{
+		case IdleLoop::Halt:
+			return true;
+		case IdleLoop::KeyWait:
+			return std::all_of(key.begin(), key.end(), [](unsigned char k) { return k == 0; });
+		case IdleLoop::KeyPoll:
+		{
+			if (_vRegister[x] > 0xF)
+			{
+				return false;
+			}
+			bool pressed = key[_vRegister[x]] != 0;
+			return (first & 0x00FF) == 0x009E ? !pressed : pressed;
+		}
+		case IdleLoop::DelayWait:
+			return _delayTimer != (opcodeAt(head + 2) & 0x00FF);
+		default:
+			return false;
+		}
+	}
+
+	unsigned int Machine::runCycles(unsigned int cycles, bool skipIdle)
+	{
+		unsigned int interpreted = 0;
+
+		for (unsigned int i = 0; i < cycles; i++)
+		{
+			emulateCycle();
+			interpreted++;
+
+			//Only look for a loop after a back-edge jump or a stalled key wait
+			if (!skipIdle || ((_opcode & 0xF000) != 0x1000 && (_opcode & 0xF0FF) != 0xF00A))
+			{
+				continue;
+			}
+
+			unsigned short head = 0;
+			unsigned short length = 0;
+			IdleLoop loop = detectIdleLoop(&head, &length);
+			if (loop == IdleLoop::None || _programCounter != head || !isIdleIteration(loop, head))
+			{
+				continue;
+			}
+			if (loop == IdleLoop::DelayWait && _vRegister[(opcodeAt(head) & 0x0F00) >> 8] != _delayTimer)
+			{
+				continue;
+			}
+
+			//We've just finished a full iteration back at the head, so the state is a fixed
+			//point of the loop body: any further whole iterations this frame change nothing.
+			unsigned int remaining = cycles - i - 1;
+			unsigned int skipped = remaining - (remaining % length);
+			_cycleCount += skipped;
+			if (_profiler)
+			{
+				_profiler->countCycles(skipped);
+			}
+			i += skipped;
+		}
+
+		return interpreted;
+	}
+
+	unsigned long long Machine::idleFrames(unsigned int cyclesPerFrame) const
+	{
+		unsigned short head = 0;
+		unsigned short length = 0;
+		IdleLoop loop = detectIdleLoop(&head, &length);
+		if (loop == IdleLoop::None || _programCounter != head || cyclesPerFrame < length || !isIdleIteration(loop, head))
+		{
+			return 0;
+		}
+
+		//Each idle frame is cyclesPerFrame cycles of the loop followed by one cycleTimers().
+		//Stop before the frame where the sound timer expires, so the caller still gets its beep.
+		unsigned long long frames = std::numeric_limits<unsigned long long>::max();
+		if (_soundTimer > 0)
+		{
+			frames = _soundTimer - 1u;
+		}
+
+		if (loop == IdleLoop::DelayWait)
+		{
+			//Frame i reads a delay timer of (DT - i + 1); the loop exits on the frame where that equals kk
+			unsigned char target = static_cast<unsigned char>(opcodeAt(head + 2) & 0x00FF);
+			if (_delayTimer > target)
+			{
+				frames = std::min<unsigned long long>(frames, _delayTimer - target);
+			}
+		}
+
+		return frames;
+	}
+
+	unsigned long long Machine::skipIdleFrames(unsigned long long maxFrames, unsigned int cyclesPerFrame)
+	{
+		unsigned long long frames = std::min(maxFrames, idleFrames(cyclesPerFrame));
+		if (frames == 0)
+		{
+			return 0;
+		}
+
+		unsigned short head = 0;
+		unsigned short length = 0;
+		IdleLoop loop = detectIdleLoop(&head, &length);
+		unsigned char x = static_cast<unsigned char>((opcodeAt(head) & 0x0F00) >> 8);
+
+		unsigned long long cycles = frames * cyclesPerFrame;
+		if (loop == IdleLoop::DelayWait)
+		{
+			//Every frame runs the whole body at least once, so Vx holds the timer as read in the last frame
+			_vRegister[x] = (frames - 1) >= _delayTimer ? 0 : static_cast<unsigned char>(_delayTimer - (frames - 1));
+		}
+		_delayTimer = frames >= _delayTimer ? 0 : static_cast<unsigned char>(_delayTimer - frames);
+		if (_soundTimer > 0)
+		{
+			_soundTimer = static_cast<unsigned char>(_soundTimer - frames);
+		}
+		_programCounter = static_cast<unsigned short>(head + 2 * (cycles % length));
+		_opcode = opcodeAt(static_cast<unsigned short>(head + 2 * ((cycles - 1) % length)));
+		_cycleCount += cycles;
+
+		if (_profiler)
+		{
+			_profiler->countCycles(cycles);
+		}
+
+		return frames;
+	}
+
+	unsigned int Machine::runFrames(unsigned long long frames, unsigned int cyclesPerFrame)
+	{
+		unsigned int beeps = 0;
+		unsigned long long frame = 0;
+
+		while (frame < frames)
+		{
+			auto skipped = skipIdleFrames(frames - frame, cyclesPerFrame);
+			if (skipped > 0)
+			{
+				frame += skipped;
+				continue;
+			}
+
+			runCycles(cyclesPerFrame, true);
+			if (cycleTimers())
+			{
+				beeps++;
+			}
+			frame++;
+		}
+
+		return beeps;
+	}
+
+	bool Machine::implemented(unsigned short opcode)
+	{
+		switch ((opcode & 0xF000) >> 12)
+		{
+		case 0x0:
+			return (opcode & 0x000F) == 0x0000 || (opcode & 0x000F) == 0x000E;
+		case 0x8:
+			return (opcode & 0x000F) <= 0x7 || (opcode & 0x000F) == 0xE;
+		case 0xE:
+			return (opcode & 0x00FF) == 0x9E || (opcode & 0x00FF) == 0xA1;
+		case 0xF:
+			switch (opcode & 0x00FF)
+			{
+			case 0x07: case 0x0A: case 0x15: case 0x18: case 0x1E: case 0x29: case 0x33: case 0x55: case 0x65:
+				return true;
+			}
+			return false;
+		}
+		return true;
+	}
+
+	std::string Machine::disassemble(unsigned short opcode)
+	{
+		std::stringstream out;
+		out << std::hex;
+		unsigned int x = (opcode & 0x0F00) >> 8;
+		unsigned int y = (opcode & 0x00F0) >> 4;
+		unsigned int kk = opcode & 0x00FF;
+		unsigned int nnn = opcode & 0x0FFF;
+
+		switch ((opcode & 0xF000) >> 12)
+		{
+		case 0x0:
+			if ((opcode & 0x000F) == 0x0000) out << "CLS";
+			else if ((opcode & 0x000F) == 0x000E) out << "RET";
+			break;
+		case 0x1: out << "JP " << nnn; break;
+		case 0x2: out << "CALL $" << nnn; break;
+		case 0x3: out << "SE V" << x << ", " << kk; break;
+		case 0x4: out << "SNE V" << x << ", " << kk; break;
+		case 0x5: out << "SE V" << x << ", V" << y; break;
+		case 0x6: out << "LD V" << x << ", " << kk; break;
+		case 0x7: out << "ADD V" << x << ", " << kk; break;
+		case 0x8:
+		{
+			switch (opcode & 0x000F)
+			{
+			case 0x0: out << "LD V" << x << ", V" << y; break;
+			case 0x1: out << "OR V" << x << ", V" << y; break;
+			case 0x2: out << "AND V" << x << ", V" << y; break;
+			case 0x3: out << "XOR V" << x << ", V" << y; break;
+			case 0x4: out << "ADD V" << x << ", V" << y; break;
+			case 0x5: out << "SUB V" << x << ", V" << y; break;
+			case 0x6: out << "SHR V" << x; break;
+			case 0x7: out << "SUBN V" << x << ", V" << y; break;
+			case 0xE: out << "SHL V" << x; break;
+			}
+			break;
+		}
+		case 0x9: out << "SNE V" << x << ", V" << y; break;
+		case 0xA: out << "LD I, " << nnn; break;
+		case 0xB: out << "JP V0, $" << nnn; break;
+		case 0xC: out << "RND V" << x; break;
+		case 0xD: out << "DRW V" << x << ", V" << y << ", " << (opcode & 0x000F); break;
+		case 0xE:
+			if (kk == 0x9E) out << "SKP V" << x;
+			else if (kk == 0xA1) out << "SKNP V" << x;
+			break;
+		case 0xF:
+		{
+			switch (kk)
+			{
+			case 0x07: out << "LD V" << x << ", T"; break;
+			case 0x0A: out << "LD V" << x << ", K"; break;
+			case 0x15: out << "LD DT, V" << x; break;
+			case 0x18: out << "LD ST, V" << x; break;
+			case 0x1E: out << "ADD I, V" << x; break;
+			case 0x29: out << "LD F, V" << x; break;
+			case 0x33: out << "LD B, V" << x; break;
+			case 0x55: out << "LD [I], V" << x; break;
+			case 0x65: out << "LD V" << x << ", [I]"; break;
+			}
+			break;
+		}
+		}
+
+		//Empty if the opcode isn't one we implement
+		return out.str();
+	}
+
+	//Defining Functions
+	void Machine::op00E0()
+	{
+		//Clear Screen - a memset even in unoptimised and sanitizer builds, where zeroed memory
+		//(0000 decodes as 00E0) can run this every cycle
+		gfx.fill(0);
+		drawFlag = true;
+		_programCounter += 2;
+	}
+
+	void Machine::op00EE()
+	{
+		//Return
+		CHECK_GUEST(_sp > 0, FaultKind::StackUnderflow, _sp);
+		_sp--;
+		_programCounter = _stack[_sp & 0xF];
+		_programCounter += 2;
+		if (_profiler)
+		{
+			_profiler->leaveRoutine(_sp);
+		}
+	}
+
+	void Machine::op1nnn()
+	{
+		//Jump to Location nnn
+		_programCounter = (_opcode & 0x0FFF);
+	}
+
+	void Machine::op2nnn()
+	{
+		//Call nnn
+		CHECK_GUEST(_sp < _stack.size(), FaultKind::StackOverflow, _sp);
+		_stack[_sp & 0xF] = _programCounter;
+		_sp++;
+		_programCounter = (_opcode & 0x0FFF);
+		if (_profiler)
+		{
+			_profiler->enterRoutine(_programCounter, _sp);
+		}
+	}
+
+	void Machine::op3xkk()
+	{
+		//Skip next instr. if Vx == kk
+		if (_vRegister[(_opcode & 0x0F00) >> 8] == (_opcode & 0x00FF))
+		{
+			_programCounter += 4;
+		}
+		else
+		{
+			_programCounter += 2;
+		}
+	}
+
+	void Machine::op4xkk()
+	{
+		//Skip next instr. if Vx != kk
+		if (_vRegister[(_opcode & 0x0F00) >> 8] != (_opcode & 0x00FF))
+		{
+			_programCounter += 4;
+		}
+		else
+		{
+			_programCounter += 2;
+		}
+	}
+
+	void Machine::op5xy0()
+	{
+		//Skip next instr. if Vx = Vy
+		if (_vRegister[(_opcode & 0x0F00) >> 8] == _vRegister[(_opcode & 0x00F0) >> 4])
+		{
+			_programCounter += 4;
+		}
+		else
+		{
+			_programCounter += 2;
+		}
+	}
+
+	void Machine::op6xkk()
+	{
+		//Set Vx = kk
+		_vRegister[(_opcode & 0x0F00) >> 8] = (_opcode & 0x00FF);
+		_programCounter += 2;
+	}
+
+	void Machine::op7xkk()
+	{
+		//Set Vx = Vx + kk
+		_vRegister[(_opcode & 0x0F00) >> 8] += (_opcode & 0x00FF);
+		_programCounter += 2;
+	}
+
+	void Machine::op8xy0()
+	{
+		//Set Vx = Vy
+		_vRegister[(_opcode & 0x0F00) >> 8] = _vRegister[(_opcode & 0x00F0) >> 4];
+		_programCounter += 2;
+	}
+
+	void Machine::op8xy1()
+	{
+		//Set Vx = Vx OR Vy
+		_vRegister[(_opcode & 0x0F00) >> 8] |= _vRegister[(_opcode & 0x00F0) >> 4];
+		_programCounter += 2;
+	}
+
+	void Machine::op8xy2()
+	{
+		//Set Vx = Vx AND Vy
+		_vRegister[(_opcode & 0x0F00) >> 8] &= _vRegister[(_opcode & 0x00F0) >> 4];
+		_programCounter += 2;
+	}
+
+	void Machine::op8xy3()
+	{
+		//Set Vx = Vx XOR Vy
+		_vRegister[(_opcode & 0x0F00) >> 8] ^= _vRegister[(_opcode & 0x00F0) >> 4];
+		_programCounter += 2;
+	}
+
+	void Machine::op8xy4()
+	{
+		//Set Vx = Vx + Vy, set VF = carry
+		_vRegister[0xF] = Core::carry(_vRegister[(_opcode & 0x0F00) >> 8], _vRegister[(_opcode & 0x00F0) >> 4]);
+		_vRegister[(_opcode & 0x0F00) >> 8] += _vRegister[(_opcode & 0x00F0) >> 4];
+		_programCounter += 2;
+	}
+
+	void Machine::op8xy5()
+	{
+		//Set Vx = Vx - Vy, set VF = NOT borrow
+		_vRegister[0xF] = Core::noBorrow(_vRegister[(_opcode & 0x0F00) >> 8], _vRegister[(_opcode & 0x00F0) >> 4]);
+		_vRegister[(_opcode & 0x0F00) >> 8] -= _vRegister[(_opcode & 0x00F0) >> 4];
+		_programCounter += 2;
+	}
+
+	void Machine::op8xy6()
+	{
+		//Set Vx = Vx SHR 1
+		_vRegister[0xF] = (_vRegister[(_opcode & 0x0F00) >> 8] & 0x1);
+		_vRegister[(_opcode & 0x0F00) >> 8] >>= 1;
+		_programCounter += 2;
+	}
+
+	void Machine::op8xy7()
+	{
+		//Set Vx = Vy - Vx, set VF = NOT borrow
+		_vRegister[0xF] = Core::noBorrow(_vRegister[(_opcode & 0x00F0) >> 4], _vRegister[(_opcode & 0x0F00) >> 8]);
+		_vRegister[(_opcode & 0x0F00) >> 8] = _vRegister[(_opcode & 0x00F0) >> 4] - _vRegister[(_opcode & 0x0F00) >> 8];
+		_programCounter += 2;
+	}
+
+	void Machine::op8xyE()
+	{
+		//Set Vx = Vx SHL 1
+		_vRegister[0xF] = (_vRegister[(_opcode & 0x0F00) >> 8]) >> 7;
+		_vRegister[(_opcode & 0x0F00) >> 8] <<= 1;
+		_programCounter += 2;
+	}
+
+	void Machine::op9xy0()
+	{
+		//Skip next instr. if Vx != Vy
+		if (_vRegister[(_opcode & 0x0F00) >> 8] != _vRegister[(_opcode & 0x00F0) >> 4])
+		{
+			_programCounter += 4;
+		}
+		else
+		{
+			_programCounter += 2;
+		}
+	}
+
+	void Machine::opAnnn()
+	{
+		//Set I = nnn
+		_index = (_opcode & 0x0FFF);
+		_programCounter += 2;
+	}
+
+	void Machine::opBnnn()
+	{
+		//Jump to location nnn + V0
+		_programCounter = (_opcode & 0x0FFF) + _vRegister[0x0];
+	}
+
+	void Machine::opCxkk()
+	{
+		//Set Vx = random byte AND kk
+		_vRegister[(_opcode & 0x0F00) >> 8] = nextRandom() & (_opcode & 0x00FF);
+		_programCounter += 2;
+	}
+
+	void Machine::opDxyn()
+	{
+		unsigned short x = _vRegister[(_opcode & 0x0F00) >> 8];
+		unsigned short y = _vRegister[(_opcode & 0x00F0) >> 4];
+		unsigned short h = (_opcode & 0x000F);
+		unsigned short pixel;
+
+		unsigned short lit = 0;
+
+		_vRegister[0xF] = 0;
+		int mem;
+		for (int yLine = 0; yLine < static_cast<int>(h); yLine++)
+		{
+			mem = _index + yLine;
+			CHECK_GUEST(mem < Memory::Size, FaultKind::MemoryRead, static_cast<unsigned int>(mem));
+			pixel = _memory[mem];
+			lit |= pixel;
+
+			//Blank sprite rows are common (padding, erasing with a blank sprite), so skip them outright
+			if (pixel == 0)
+			{
+				continue;
+			}
+			auto& bits = Core::SpriteBits[pixel];
+			for (int xLine = 0; xLine < 8; xLine++)
+			{
+				auto point = (x + xLine + ((y + yLine) * 64)) % 2048;
+				_vRegister[0xF] |= gfx[point] & bits[xLine];
+				gfx[point] ^= bits[xLine];
+			}
+		}
+
+		drawFlag = true;
+		_drawCount++;
+		if (_latency && lit != 0)
+		{
+			_latency->drawn(_cycleCount);
+		}
+		_programCounter += 2;
+	}
+
+	void Machine::opEx9E()
+	{
+		//SKP Vx
+		//Skip next instruction if key with Vx value is pressed
+		CHECK_GUEST(_vRegister[(_opcode & 0x0F00) >> 8] < key.size(), FaultKind::KeyIndex, _vRegister[(_opcode & 0x0F00) >> 8]);
+		if (_latency)
+		{
+			_latency->observed(_vRegister[(_opcode & 0x0F00) >> 8] & 0xF, _cycleCount);
+		}
+		if (key[_vRegister[(_opcode & 0x0F00) >> 8] & 0xF] != 0)
+		{
+			_programCounter += 4;
+		}
+		else
+		{
+			_programCounter += 2;
+		}
+	}
+
+	void Machine::opExA1()
+	{
+		//SKNP Vx
+		//Skip next instruction if key with Vx value is not pressed
+		CHECK_GUEST(_vRegister[(_opcode & 0x0F00) >> 8] < key.size(), FaultKind::KeyIndex, _vRegister[(_opcode & 0x0F00) >> 8]);
+		if (_latency)
+		{
+			_latency->observed(_vRegister[(_opcode & 0x0F00) >> 8] & 0xF, _cycleCount);
+		}
+		if (key[_vRegister[(_opcode & 0x0F00) >> 8] & 0xF] == 0)
+		{
+			_programCounter += 4;
+		}
+		else
+			_programCounter += 2;
+	}
+
+	void Machine::opFx07()
+	{
+		_vRegister[(_opcode & 0x0F00) >> 8] = _delayTimer;
+		_programCounter += 2;
+	}
+
+	void Machine::opFx0A()
+	{
+		bool pressed = false;
+		if (_latency)
+		{
+			_latency->observed(LatencyTracker::AnyKey, _cycleCount);
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			if (key[i] != 0)
+			{
+				_vRegister[(_opcode & 0x0F00) >> 8] = 1;
+				pressed = true;
+			}
+		}
+
+		if (!pressed) return;
+
+		_programCounter += 2;
+	}
+
+	void Machine::opFx15()
+	{
+		_delayTimer = _vRegister[(_opcode & 0x0F00) >> 8];
+		_programCounter += 2;
+	}
+
+	void Machine::opFx18()
+	{
+		_soundTimer = _vRegister[(_opcode & 0x0F00) >> 8];
+		_programCounter += 2;
+	}
+
+	void Machine::opFx1E()
+	{
+		if (_index + _vRegister[(_opcode & 0x0F00) >> 8] > 0xFFF)
+		{
+			_vRegister[0xF] = 1; //overflow
+		}
+		else
+		{
+			_vRegister[0xF] = 0;
+		}
+
+		_index += _vRegister[(_opcode & 0x0F00) >> 8];
+		_programCounter += 2;
+	}
+
+	void Machine::opFx29()
+	{
+		_index = Core::fontAddress(_vRegister[(_opcode & 0x0F00) >> 8]);
+		_programCounter += 2;
+	}
+
+	void Machine::opFx33()
+	{
+		CHECK_GUEST(_index + 2u < Memory::Size, FaultKind::MemoryWrite, std::max<unsigned int>(_index, Memory::Size));
+		unsigned short indexOne = static_cast<unsigned short>(_index + 1);
+		unsigned short indexTwo = static_cast<unsigned short>(_index + 2);
+		auto& digits = Core::BcdTable[_vRegister[(_opcode & 0x0F00) >> 8]];
+		_memory.write(_index, digits[0]);
+		_memory.write(indexOne, digits[1]);
+		_memory.write(indexTwo, digits[2]);
+		_programCounter += 2;
+	}
+
+	void Machine::opFx55()
+	{
+		CHECK_GUEST(_index + ((_opcode & 0x0F00) >> 8) < Memory::Size, FaultKind::MemoryWrite, std::max<unsigned int>(_index, Memory::Size));
+		for (int i = 0; i <= ((_opcode & 0x0F00) >> 8); i++)
+		{
+			unsigned short var = _index + static_cast<unsigned short>(i);
+			_memory.write(var, _vRegister[i]);
+		}
+		_index += ((_opcode & 0x0F00) >> 8) + 1u;
+		_programCounter += 2;
+	}
+
+	void Machine::opFx65()
+	{
+		CHECK_GUEST(_index + ((_opcode & 0x0F00) >> 8) < Memory::Size, FaultKind::MemoryRead, std::max<unsigned int>(_index, Memory::Size));
+		for (int i = 0; i <= ((_opcode & 0x0F00) >> 8); i++)
+		{
+			unsigned short var = _index + static_cast<unsigned short>(i);
+			_vRegister[i] = _memory[var];
+		}
+		_index += ((_opcode & 0x0F00) >> 8) + 1;
+		_programCounter += 2;
+	}
+
+	//The shared core, checked by the compiler: flag helpers, BCD, and a few tiny ROMs run to completion
+	namespace {
+		static_assert(Core::carry(0xFF, 0x01) == 1 && Core::carry(0xFE, 0x01) == 0, "8xy4 carry");
+		static_assert(Core::noBorrow(0x01, 0x02) == 0 && Core::noBorrow(0x02, 0x02) == 1, "8xy5 borrow");
+		static_assert(Core::BcdTable[254][0] == 2 && Core::BcdTable[254][1] == 5 && Core::BcdTable[254][2] == 4, "Fx33 digits");
+		static_assert(Core::SpriteBits[0x81][0] == 1 && Core::SpriteBits[0x81][1] == 0 && Core::SpriteBits[0x81][7] == 1, "Sprite bits");
+
+		//VA = 254; I = 0x300; BCD; V0-V2 = digits; spin
+		constexpr auto bcdRom = Core::run(Core::boot(std::array<unsigned char, 10>{ 0x6A, 0xFE, 0xA3, 0x00, 0xFA, 0x33, 0xF2, 0x65, 0x12, 0x08 }), 1);
+		static_assert(bcdRom.registers[0] == 2 && bcdRom.registers[1] == 5 && bcdRom.registers[2] == 4 && bcdRom.index == 0x303, "BCD ROM");
+
+		//Draw the "0" glyph at 0,0 twice: lit, then erased with a collision
+		constexpr auto drawRom = Core::run(Core::boot(std::array<unsigned char, 8>{ 0xF0, 0x29, 0xD0, 0x05, 0xD0, 0x05, 0x12, 0x06 }), 1);
+		static_assert(drawRom.gfx[0] == 0 && drawRom.registers[0xF] == 1 && drawRom.programCounter == 0x206, "Draw ROM");
+		constexpr auto drawOnce = Core::run(Core::boot(std::array<unsigned char, 6>{ 0xF0, 0x29, 0xD0, 0x05, 0x12, 0x04 }), 1);
+		static_assert(drawOnce.gfx[0] == 1 && drawOnce.gfx[3] == 1 && drawOnce.gfx[4] == 0 && drawOnce.gfx[65] == 0 && drawOnce.registers[0xF] == 0, "Draw once");
+
+		//CALL / RET, then the delay timer counting down over frames
+		constexpr auto callRom = Core::run(Core::boot(std::array<unsigned char, 10>{ 0x22, 0x06, 0xF0, 0x15, 0x12, 0x04, 0x60, 0x05, 0x00, 0xEE }), 3);
+		static_assert(callRom.registers[0] == 5 && callRom.sp == 0 && callRom.delayTimer == 2, "Call ROM");
+	};
+};
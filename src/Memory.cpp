@@ -0,0 +1,89 @@
+//Copy-on-write CHIP-8 address space.
+
+#include "Memory.h"
+#include <algorithm>
+
+namespace Chip8 {
+	Memory::Memory(std::shared_ptr<const Image> image) :
+		_dirtyMask(0)
+	{
+		reset(std::move(image));
+	}
+
+	Memory::Memory(const Memory& other)
+	{
+		copyFrom(other);
+	}
+
+	Memory& Memory::operator=(const Memory& other)
+	{
+		if (this != &other)
+		{
+			copyFrom(other);
+		}
+		return *this;
+	}
+
+	void Memory::copyFrom(const Memory& other)
+	{
+		//Only the pages the other side has written are copied; the rest keep pointing at the shared image
+		_image = other._image;
+		_dirtyMask = other._dirtyMask;
+		for (unsigned short page = 0; page < PageCount; page++)
+		{
+			if (_dirtyMask & (1u << page))
+			{
+				_private[page] = other._private[page];
+				_pages[page] = _private[page].data();
+			}
+			else
+			{
+				_pages[page] = _image->data() + page * PageSize;
+			}
+		}
+	}
+
+	void Memory::write(unsigned short address, unsigned char value)
+	{
+		address &= Size - 1;
+		unsigned short page = address / PageSize;
+		if (!(_dirtyMask & (1u << page)))
+		{
+			auto shared = _image->begin() + page * PageSize;
+			std::copy(shared, shared + PageSize, _private[page].begin());
+			_pages[page] = _private[page].data();
+			_dirtyMask |= static_cast<unsigned short>(1u << page);
+		}
+		_private[page][address % PageSize] = value;
+	}
+
+	void Memory::reset(std::shared_ptr<const Image> image)
+	{
+		_image = std::move(image);
+		_dirtyMask = 0;
+		for (unsigned short page = 0; page < PageCount; page++)
+		{
+			_pages[page] = _image->data() + page * PageSize;
+		}
+	}
+
+	Memory::Image Memory::snapshot() const
+	{
+		Image copy;
+		for (unsigned short page = 0; page < PageCount; page++)
+		{
+			std::copy(_pages[page], _pages[page] + PageSize, copy.begin() + page * PageSize);
+		}
+		return copy;
+	}
+
+	unsigned int Memory::privatePages() const
+	{
+		unsigned int count = 0;
+		for (unsigned short page = 0; page < PageCount; page++)
+		{
+			count += (_dirtyMask >> page) & 1u;
+		}
+		return count;
+	}
+};
@@ -0,0 +1,179 @@
+//Live runtime counters, served in Prometheus text format on a local socket.
+
+#include "Metrics.h"
+#include <iomanip>
+#include <sstream>
+
+namespace Chip8 {
+	const std::array<double, Metrics::FrameTimeBuckets> Metrics::FrameTimeBounds =
+	{
+		0.002, 0.004, 0.008, 0.012, 0.0167, 0.020, 0.025, 0.0334, 0.050, 0.100, 0.250, 0.0
+	};
+
+	void Metrics::recordFrameTime(std::chrono::steady_clock::duration frameTime)
+	{
+		double seconds = std::chrono::duration<double>(frameTime).count();
+		size_t bucket = 0;
+		while (bucket < FrameTimeBuckets - 1 && seconds > FrameTimeBounds[bucket])
+		{
+			bucket++;
+		}
+		add(frameTimes[bucket], 1);
+		add(frameTimeTotalMicros, static_cast<unsigned long long>(seconds * 1e6));
+	}
+
+	double Metrics::frameTimePercentile(double percentile) const
+	{
+		//Interpolated within the bucket, like Prometheus' histogram_quantile
+		std::array<unsigned long long, FrameTimeBuckets> counts;
+		unsigned long long total = 0;
+		for (size_t i = 0; i < FrameTimeBuckets; i++)
+		{
+			counts[i] = frameTimes[i].load(std::memory_order_relaxed);
+			total += counts[i];
+		}
+		if (total == 0)
+		{
+			return 0.0;
+		}
+
+		double rank = percentile * total;
+		double below = 0.0;
+		for (size_t i = 0; i < FrameTimeBuckets; i++)
+		{
+			if (below + counts[i] >= rank && counts[i] > 0)
+			{
+				double lower = i == 0 ? 0.0 : FrameTimeBounds[i - 1];
+				if (i == FrameTimeBuckets - 1)
+				{
+					return lower;
+				}
+				return lower + (FrameTimeBounds[i] - lower) * ((rank - below) / counts[i]);
+			}
+			below += counts[i];
+		}
+		return FrameTimeBounds[FrameTimeBuckets - 2];
+	}
+
+	std::string Metrics::render(double instructionsPerSecond) const
+	{
+		auto value = [](const std::atomic<unsigned long long>& counter) { return counter.load(std::memory_order_relaxed); };
+		std::ostringstream out;
+
+		out << "# HELP chip8_instructions_total Emulated CHIP-8 instructions, including fast-forwarded idle loops.\n"
+			<< "# TYPE chip8_instructions_total counter\n"
+			<< "chip8_instructions_total " << value(instructions) << "\n"
+			<< "# HELP chip8_instructions_per_second Emulated instructions per second since the previous scrape.\n"
+			<< "# TYPE chip8_instructions_per_second gauge\n"
+			<< "chip8_instructions_per_second " << std::fixed << std::setprecision(1) << instructionsPerSecond << "\n"
+			<< "# HELP chip8_frames_presented_total Host frames presented.\n"
+			<< "# TYPE chip8_frames_presented_total counter\n"
+			<< "chip8_frames_presented_total " << value(framesPresented) << "\n"
+			<< "# HELP chip8_framebuffer_updates_total Host frames where the CHIP-8 framebuffer was pushed to the screen.\n"
+			<< "# TYPE chip8_framebuffer_updates_total counter\n"
+			<< "chip8_framebuffer_updates_total " << value(framebufferUpdates) << "\n"
+			<< "# HELP chip8_draws_total Dxyn sprite draws executed by the guest.\n"
+			<< "# TYPE chip8_draws_total counter\n"
+			<< "chip8_draws_total " << value(draws) << "\n"
+			<< "# HELP chip8_beeps_silent_total Beeps requested with no audio device.\n"
+			<< "# TYPE chip8_beeps_silent_total counter\n"
+			<< "chip8_beeps_silent_total " << value(beepsSilent) << "\n"
+			<< "# HELP chip8_beeps_cut_off_total Beeps that restarted the tone while the previous one was still playing.\n"
+			<< "# TYPE chip8_beeps_cut_off_total counter\n"
+			<< "chip8_beeps_cut_off_total " << value(beepsCutOff) << "\n";
+
+		out << "# HELP chip8_host_frame_seconds Host time between frame updates.\n"
+			<< "# TYPE chip8_host_frame_seconds histogram\n";
+		unsigned long long cumulative = 0;
+		out << std::setprecision(4);
+		for (size_t i = 0; i < FrameTimeBuckets; i++)
+		{
+			cumulative += value(frameTimes[i]);
+			out << "chip8_host_frame_seconds_bucket{le=\"";
+			if (i == FrameTimeBuckets - 1)
+			{
+				out << "+Inf";
+			}
+			else
+			{
+				out << FrameTimeBounds[i];
+			}
+			out << "\"} " << cumulative << "\n";
+		}
+		out << "chip8_host_frame_seconds_sum " << std::setprecision(6) << value(frameTimeTotalMicros) / 1e6 << "\n"
+			<< "chip8_host_frame_seconds_count " << cumulative << "\n";
+
+		out << "# HELP chip8_host_frame_seconds_quantile Host frame time percentiles, estimated from the histogram.\n"
+			<< "# TYPE chip8_host_frame_seconds_quantile gauge\n";
+		for (double quantile : { 0.5, 0.9, 0.99 })
+		{
+			out << "chip8_host_frame_seconds_quantile{quantile=\"" << std::setprecision(2) << quantile << "\"} "
+				<< std::setprecision(6) << frameTimePercentile(quantile) << "\n";
+		}
+
+		out << "# HELP chip8_rom_info Loaded ROM, identified by its 64-bit FNV-1a hash.\n"
+			<< "# TYPE chip8_rom_info gauge\n"
+			<< "chip8_rom_info{hash=\"" << std::hex << std::setw(16) << std::setfill('0') << romHash.load(std::memory_order_relaxed)
+			<< std::dec << "\"} 1\n"
+			<< "# HELP chip8_clock_hz Emulated instructions per second the clock is set to.\n"
+			<< "# TYPE chip8_clock_hz gauge\n"
+			<< "chip8_clock_hz " << clockHz.load(std::memory_order_relaxed) << "\n";
+
+		return out.str();
+	}
+
+	MetricsServer::MetricsServer(const Metrics& metrics, const std::string& address) :
+		_listener(Net::listen(address)),
+		_metrics(metrics),
+		_stopping(false)
+	{
+		_thread = std::thread(&MetricsServer::serve, this);
+	}
+
+	MetricsServer::~MetricsServer()
+	{
+		_stopping = true;
+		_thread.join();
+		Net::close(_listener);
+	}
+
+	void MetricsServer::serve()
+	{
+		auto lastTime = std::chrono::steady_clock::now();
+		auto lastInstructions = _metrics.instructions.load(std::memory_order_relaxed);
+
+		while (!_stopping)
+		{
+			//Short timeout so shutdown never waits long
+			auto client = Net::accept(_listener, 200);
+			if (client == Net::InvalidHandle)
+			{
+				continue;
+			}
+
+			//Peek at the request, if the client sent one, to decide whether to answer in HTTP
+			char request[512];
+			long received = Net::waitReadable(client, 50) ? Net::receive(client, request, sizeof(request)) : 0;
+			bool http = received >= 4 && std::string(request, 4) == "GET ";
+
+			auto now = std::chrono::steady_clock::now();
+			auto instructions = _metrics.instructions.load(std::memory_order_relaxed);
+			double elapsed = std::chrono::duration<double>(now - lastTime).count();
+			double rate = elapsed > 0.0 ? (instructions - lastInstructions) / elapsed : 0.0;
+			lastTime = now;
+			lastInstructions = instructions;
+
+			auto body = _metrics.render(rate);
+			if (http)
+			{
+				std::ostringstream header;
+				header << "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " << body.size()
+					<< "\r\nConnection: close\r\n\r\n";
+				auto text = header.str();
+				Net::sendAll(client, text.data(), text.size());
+			}
+			Net::sendAll(client, body.data(), body.size());
+			Net::close(client);
+		}
+	}
+};
@@ -0,0 +1,184 @@
+//Batched presenter for many machines in one NovelRT window.
+
+#include "MosaicPresenter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Chip8 {
+	namespace {
+		const size_t CellBytes = Machine::PackedFramebufferSize;
+		const float Gap = 8.0f;					//Pixels between cells, in screen units
+		const float FrameWidth = 3.0f;
+	};
+
+	MosaicPresenter::MosaicPresenter(std::weak_ptr<NovelRT::Graphics::RenderingService> renderer, size_t count, float width, float height) :
+		_atlas(count * CellBytes, 0),
+		_cells(count),
+		_dirty(count, false),
+		_pixelSize(0),
+		_renderer(renderer),
+		_shown(count * CellBytes, 0)
+	{
+		//Columns chosen for the biggest pixels that fit
+		size_t bestColumns = 1;
+		for (size_t columns = 1; columns <= count; columns++)
+		{
+			size_t rows = (count + columns - 1) / columns;
+			float size = std::min((width - Gap * (columns + 1)) / (columns * 64.0f), (height - Gap * (rows + 1)) / (rows * 32.0f));
+			if (size > _pixelSize)
+			{
+				_pixelSize = size;
+				bestColumns = columns;
+			}
+		}
+
+		size_t rows = (count + bestColumns - 1) / bestColumns;
+		float cellWidth = 64.0f * _pixelSize;
+		float cellHeight = 32.0f * _pixelSize;
+		float marginX = (width - bestColumns * cellWidth - (bestColumns - 1) * Gap) / 2;
+		float marginY = (height - rows * cellHeight - (rows - 1) * Gap) / 2;
+		for (size_t i = 0; i < count; i++)
+		{
+			_cells[i].left = marginX + (i % bestColumns) * (cellWidth + Gap);
+			_cells[i].top = marginY + (i / bestColumns) * (cellHeight + Gap);
+		}
+
+		//Four bars around the focused cell, moved by setFocus
+		for (auto& bar : _focusFrame)
+		{
+			bar = _renderer.lock()->createBasicFillRect(NovelRT::Transform(), 2, NovelRT::Graphics::RGBAConfig(90, 90, 90, 255));
+		}
+		setFocus(0);
+	}
+
+	unsigned int MosaicPresenter::acquire()
+	{
+		if (!_free.empty())
+		{
+			auto index = _free.back();
+			_free.pop_back();
+			_pool[index]->setActive(true);
+			return index;
+		}
+
+		//The pool only grows until it covers the busiest screens seen so far
+		_pool.push_back(_renderer.lock()->createBasicFillRect(NovelRT::Transform(), 1, NovelRT::Graphics::RGBAConfig(255, 255, 255, 255)));
+		_free.reserve(_pool.size());
+		return static_cast<unsigned int>(_pool.size() - 1);
+	}
+
+	void MosaicPresenter::layout(size_t index)
+	{
+		auto& cell = _cells[index];
+		for (auto rect : cell.rects)
+		{
+			_pool[rect]->setActive(false);
+			_free.push_back(rect);
+		}
+		cell.rects.clear();
+
+		const unsigned char* bits = &_atlas[index * CellBytes];
+		auto lit = [&](int row, int column)
+		{
+			return (bits[row * 8 + column / 8] >> (7 - column % 8) & 1) != 0;
+		};
+
+		for (int row = 0; row < 32; row++)
+		{
+			int x = 0;
+			while (x < 64)
+			{
+				//Skip whole unlit bytes quickly
+				if (x % 8 == 0 && bits[row * 8 + x / 8] == 0)
+				{
+					x += 8;
+					continue;
+				}
+				if (!lit(row, x))
+				{
+					x++;
+					continue;
+				}
+
+				int start = x;
+				while (x < 64 && lit(row, x))
+				{
+					x++;
+				}
+
+				auto rect = acquire();
+				auto& transform = _pool[rect]->transform();
+				transform.position() = NovelRT::Maths::GeoVector2<float>(cell.left + (start + x) * _pixelSize / 2, cell.top + (row + 0.5f) * _pixelSize);
+				transform.scale() = NovelRT::Maths::GeoVector2<float>((x - start) * _pixelSize, _pixelSize);
+				cell.rects.push_back(rect);
+			}
+		}
+	}
+
+	void MosaicPresenter::update(size_t index, Machine& machine)
+	{
+		if (!machine.drawFlag)
+		{
+			return;
+		}
+		machine.drawFlag = false;
+		machine.packFramebuffer(&_atlas[index * CellBytes]);
+		_dirty[index] = true;
+	}
+
+	size_t MosaicPresenter::present()
+	{
+		size_t changed = 0;
+		for (size_t i = 0; i < _cells.size(); i++)
+		{
+			if (!_dirty[i])
+			{
+				continue;
+			}
+			_dirty[i] = false;
+
+			auto slot = i * CellBytes;
+			if (std::equal(_atlas.begin() + slot, _atlas.begin() + slot + CellBytes, _shown.begin() + slot))
+			{
+				continue;
+			}
+			std::copy(_atlas.begin() + slot, _atlas.begin() + slot + CellBytes, _shown.begin() + slot);
+			layout(i);
+			changed++;
+		}
+		return changed;
+	}
+
+	void MosaicPresenter::setFocus(size_t index)
+	{
+		auto& cell = _cells[index];
+		float width = 64.0f * _pixelSize;
+		float height = 32.0f * _pixelSize;
+		float centreX = cell.left + width / 2;
+		float centreY = cell.top + height / 2;
+
+		_focusFrame[0]->transform().position() = NovelRT::Maths::GeoVector2<float>(centreX, cell.top - FrameWidth / 2);
+		_focusFrame[1]->transform().position() = NovelRT::Maths::GeoVector2<float>(centreX, cell.top + height + FrameWidth / 2);
+		_focusFrame[0]->transform().scale() = NovelRT::Maths::GeoVector2<float>(width + 2 * FrameWidth, FrameWidth);
+		_focusFrame[1]->transform().scale() = NovelRT::Maths::GeoVector2<float>(width + 2 * FrameWidth, FrameWidth);
+		_focusFrame[2]->transform().position() = NovelRT::Maths::GeoVector2<float>(cell.left - FrameWidth / 2, centreY);
+		_focusFrame[3]->transform().position() = NovelRT::Maths::GeoVector2<float>(cell.left + width + FrameWidth / 2, centreY);
+		_focusFrame[2]->transform().scale() = NovelRT::Maths::GeoVector2<float>(FrameWidth, height);
+		_focusFrame[3]->transform().scale() = NovelRT::Maths::GeoVector2<float>(FrameWidth, height);
+	}
+
+	void MosaicPresenter::draw()
+	{
+		for (auto& bar : _focusFrame)
+		{
+			bar->executeObjectBehaviour();
+		}
+		for (auto& rect : _pool)
+		{
+			if (rect->getActive())
+			{
+				rect->executeObjectBehaviour();
+			}
+		}
+	}
+};
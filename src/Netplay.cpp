@@ -0,0 +1,181 @@
+//Two-player rollback netplay over a Transport.
+
+#include "Netplay.h"
+#include <algorithm>
+
+namespace Chip8 {
+	namespace {
+		//Packet: magic, ROM hash, ack (remote frames confirmed + 1), first frame, count, count key masks.
+		//All little-endian.
+		const unsigned int Magic = 0x504E3843;			//"C8NP"
+		const size_t HeaderSize = 4 + 8 + 4 + 4 + 1;
+
+		void put(unsigned char*& out, unsigned long long value, int bytes)
+		{
+			for (int i = 0; i < bytes; i++)
+			{
+				*out++ = static_cast<unsigned char>(value >> (8 * i));
+			}
+		}
+
+		unsigned long long get(const unsigned char*& in, int bytes)
+		{
+			unsigned long long value = 0;
+			for (int i = 0; i < bytes; i++)
+			{
+				value |= static_cast<unsigned long long>(*in++) << (8 * i);
+			}
+			return value;
+		}
+	};
+
+	Netplay::Netplay(Machine& machine, Transport& transport, unsigned int maxRollback, unsigned int cyclesPerFrame) :
+		_cyclesPerFrame(cyclesPerFrame),
+		_frame(0),
+		_local(History, 0),
+		_localAcked(-1),
+		_machine(machine),
+		_maxRollback(std::min(std::max(maxRollback, 1u), History / 2)),
+		_predicted(History, 0),
+		_remote(History, 0),
+		_remoteConfirmed(-1),
+		_resimulated(0),
+		_romMismatch(false),
+		_rollbackFrom(-1),
+		_rollbacks(0),
+		_snapshots(_maxRollback + 1, machine),
+		_stalls(0),
+		_transport(transport)
+	{
+	}
+
+	unsigned short Netplay::remoteFor(unsigned long long frame) const
+	{
+		if (static_cast<long long>(frame) <= _remoteConfirmed)
+		{
+			return _remote[frame % History];
+		}
+
+		//Prediction: the peer is still holding whatever it held last
+		return _remoteConfirmed >= 0 ? _remote[_remoteConfirmed % History] : 0;
+	}
+
+	void Netplay::sendInputs(long long last)
+	{
+		auto first = _localAcked + 1;
+		auto count = std::min<long long>(last - first + 1, Redundancy);
+		if (count < 0)
+		{
+			count = 0;
+		}
+
+		unsigned char packet[HeaderSize + Redundancy * 2];
+		auto out = packet;
+		put(out, Magic, 4);
+		put(out, _machine.romHash(), 8);
+		put(out, static_cast<unsigned long long>(_remoteConfirmed + 1), 4);
+		put(out, static_cast<unsigned long long>(first), 4);
+		put(out, static_cast<unsigned long long>(count), 1);
+		for (long long frame = first; frame < first + count; frame++)
+		{
+			put(out, _local[frame % History], 2);
+		}
+		_transport.send(packet, static_cast<size_t>(out - packet));
+	}
+
+	long long Netplay::receive()
+	{
+		long long mispredicted = -1;
+		unsigned char packet[HeaderSize + Redundancy * 2];
+		long size;
+		while ((size = _transport.receive(packet, sizeof(packet))) >= 0)
+		{
+			const unsigned char* in = packet;
+			if (static_cast<size_t>(size) < HeaderSize || get(in, 4) != Magic)
+			{
+				continue;
+			}
+			if (get(in, 8) != _machine.romHash())
+			{
+				_romMismatch = true;
+				continue;
+			}
+
+			auto ack = static_cast<long long>(get(in, 4));
+			auto first = static_cast<long long>(get(in, 4));
+			auto count = static_cast<long long>(get(in, 1));
+			if (static_cast<size_t>(size) < HeaderSize + count * 2)
+			{
+				continue;
+			}
+			_localAcked = std::max(_localAcked, ack - 1);
+
+			for (long long frame = first; frame < first + count; frame++)
+			{
+				auto keys = static_cast<unsigned short>(get(in, 2));
+
+				//Only accept input contiguous with what's confirmed; older copies are resends
+				if (frame != _remoteConfirmed + 1)
+				{
+					continue;
+				}
+				_remote[frame % History] = keys;
+				_remoteConfirmed = frame;
+
+				if (frame < static_cast<long long>(_frame) && keys != _predicted[frame % History] &&
+					(mispredicted < 0 || frame < mispredicted))
+				{
+					mispredicted = frame;
+				}
+			}
+		}
+		return mispredicted;
+	}
+
+	unsigned int Netplay::simulate(unsigned long long frame)
+	{
+		_snapshots[frame % _snapshots.size()] = _machine;
+		_predicted[frame % History] = remoteFor(frame);
+		_machine.setKeyMask(_local[frame % History] | _predicted[frame % History]);
+		return _machine.runFrames(1, _cyclesPerFrame);
+	}
+
+	bool Netplay::advance(unsigned short localKeys, unsigned int& beeps)
+	{
+		beeps = 0;
+
+		auto mispredicted = receive();
+		if (mispredicted >= 0 && (_rollbackFrom < 0 || mispredicted < _rollbackFrom))
+		{
+			_rollbackFrom = mispredicted;
+		}
+
+		//Too far ahead of the peer to roll back safely: wait, but keep our inputs flowing
+		if (static_cast<long long>(_frame) - (_remoteConfirmed + 1) >= static_cast<long long>(_maxRollback))
+		{
+			sendInputs(static_cast<long long>(_frame) - 1);
+			_stalls++;
+			return false;
+		}
+
+		_local[_frame % History] = localKeys;
+		sendInputs(static_cast<long long>(_frame));
+
+		if (_rollbackFrom >= 0)
+		{
+			//Rewind to the state before the first wrong guess and replay with what we know now
+			_machine = _snapshots[_rollbackFrom % _snapshots.size()];
+			for (auto frame = static_cast<unsigned long long>(_rollbackFrom); frame < _frame; frame++)
+			{
+				simulate(frame);
+				_resimulated++;
+			}
+			_rollbacks++;
+			_rollbackFrom = -1;
+		}
+
+		beeps = simulate(_frame);
+		_frame++;
+		return true;
+	}
+};
@@ -0,0 +1,168 @@
+//Guest subroutine profiler - attributes emulated cycles to CALL targets
+//and exports collapsed stacks for flamegraph tooling (flamegraph.pl, speedscope, etc.)
+
+#include "Profiler.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace Chip8 {
+	Profiler::Profiler(unsigned short entryPoint) :
+		_current(0)
+	{
+		_nodes.push_back(Node{ 0, entryPoint, 0, 0 });
+	}
+
+	void Profiler::loadLabels(const std::string& fileName)
+	{
+		std::ifstream file(fileName);
+		if (!file)
+		{
+			throw std::runtime_error("Could not open label file!");
+		}
+
+		std::string line;
+		for (size_t number = 1; std::getline(file, line); number++)
+		{
+			std::istringstream fields(line);
+			std::string address, name;
+			if (!(fields >> address >> name) || address[0] == '#' || address[0] == ';')
+			{
+				continue;
+			}
+
+			//Accept "2A0", "0x2A0" and "$2A0"
+			if (address[0] == '$')
+			{
+				address.erase(0, 1);
+			}
+			unsigned long value = 0;
+			try
+			{
+				value = std::stoul(address, nullptr, 16);
+			}
+			catch (const std::logic_error&)
+			{
+				throw std::runtime_error(fileName + ":" + std::to_string(number) + ": bad address \"" + address + "\"!");
+			}
+			_labels[static_cast<unsigned int>(value & 0x0FFF)] = name;
+		}
+	}
+
+	void Profiler::enterRoutine(unsigned short target, unsigned short sp)
+	{
+		//Resync with the guest stack in case the ROM unwound it by hand
+		while (_nodes[_current].depth >= sp && _current != 0)
+		{
+			_current = _nodes[_current].parent;
+		}
+
+		//Past the 16-entry guest stack the return addresses are gone anyway, so runaway recursion
+		//lands in one "..." frame instead of growing the trie without bound
+		if (_nodes[_current].depth < MaxDepth)
+		{
+			_current = childOf(_current, target);
+		}
+		else if (_nodes[_current].depth == MaxDepth)
+		{
+			_current = childOf(_current, DeeperCalls);
+		}
+	}
+
+	void Profiler::leaveRoutine(unsigned short sp)
+	{
+		while (_nodes[_current].depth > sp && _current != 0)
+		{
+			_current = _nodes[_current].parent;
+		}
+	}
+
+	unsigned int Profiler::childOf(unsigned int node, unsigned short routine)
+	{
+		unsigned long long key = (static_cast<unsigned long long>(node) << 16) | routine;
+		auto found = _children.find(key);
+		if (found != _children.end())
+		{
+			return found->second;
+		}
+
+		auto child = static_cast<unsigned int>(_nodes.size());
+		_nodes.push_back(Node{ node, routine, static_cast<unsigned short>(_nodes[node].depth + 1), 0 });
+		_children.emplace(key, child);
+		return child;
+	}
+
+	std::string Profiler::nameOf(unsigned short routine) const
+	{
+		if (routine == DeeperCalls)
+		{
+			return "...";
+		}
+
+		auto found = _labels.find(routine);
+		if (found != _labels.end())
+		{
+			return found->second;
+		}
+
+		std::stringstream name;
+		name << "sub_" << std::hex << std::uppercase << routine;
+		return name.str();
+	}
+
+	unsigned long long Profiler::totalCycles() const
+	{
+		unsigned long long total = 0;
+		for (auto& node : _nodes)
+		{
+			total += node.cycles;
+		}
+		return total;
+	}
+
+	void Profiler::reset()
+	{
+		for (auto& node : _nodes)
+		{
+			node.cycles = 0;
+		}
+		_current = 0;
+	}
+
+	void Profiler::writeCollapsed(const std::string& fileName) const
+	{
+		std::ofstream file(fileName);
+		if (!file)
+		{
+			throw std::runtime_error("Could not open profile output file!");
+		}
+
+		std::vector<std::string> frames;
+		for (auto& node : _nodes)
+		{
+			if (node.cycles == 0)
+			{
+				continue;
+			}
+
+			//Walk back to the root, then print outermost frame first
+			frames.clear();
+			const Node* walk = &node;
+			frames.push_back(nameOf(walk->routine));
+			while (walk->depth != 0)
+			{
+				walk = &_nodes[walk->parent];
+				frames.push_back(nameOf(walk->routine));
+			}
+			std::reverse(frames.begin(), frames.end());
+
+			for (size_t i = 0; i < frames.size(); i++)
+			{
+				file << (i == 0 ? "" : ";") << frames[i];
+			}
+			file << " " << node.cycles << "\n";
+		}
+	}
+};
@@ -0,0 +1,394 @@
+//Minimal portable socket helpers for the local-only services.
+
+#include "Socket.h"
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace Chip8 {
+	namespace Net {
+		namespace {
+			void startup()
+			{
+#ifdef _WIN32
+				static std::once_flag once;
+				std::call_once(once, []
+				{
+					WSADATA data;
+					WSAStartup(MAKEWORD(2, 2), &data);
+				});
+#endif
+			}
+
+			struct Address
+			{
+				sockaddr_storage storage;
+				socklen_t length;
+				bool local;
+				std::string path;
+			};
+
+			Address resolve(const std::string& address, int type)
+			{
+				Address result;
+				std::memset(&result.storage, 0, sizeof(result.storage));
+				result.local = false;
+
+				if (address.rfind("unix:", 0) == 0)
+				{
+					result.local = true;
+					result.path = address.substr(5);
+					sockaddr_un local;
+					std::memset(&local, 0, sizeof(local));
+					if (result.path.size() >= sizeof(local.sun_path))
+					{
+						throw std::runtime_error("Unix socket path too long: " + result.path);
+					}
+					local.sun_family = AF_UNIX;
+					std::memcpy(local.sun_path, result.path.c_str(), result.path.size());
+					std::memcpy(&result.storage, &local, sizeof(local));
+					result.length = static_cast<socklen_t>(sizeof(local));
+					return result;
+				}
+
+				std::string hostPort = address.rfind("tcp:", 0) == 0 || address.rfind("udp:", 0) == 0 ? address.substr(4) : address;
+				auto colon = hostPort.rfind(':');
+				if (colon == std::string::npos)
+				{
+					throw std::runtime_error("Expected host:port, got " + address);
+				}
+				std::string host = hostPort.substr(0, colon);
+				std::string port = hostPort.substr(colon + 1);
+
+				addrinfo hints;
+				std::memset(&hints, 0, sizeof(hints));
+				hints.ai_family = AF_INET;
+				hints.ai_socktype = type;
+				addrinfo* info = nullptr;
+				if (getaddrinfo(host.empty() ? "127.0.0.1" : host.c_str(), port.c_str(), &hints, &info) != 0 || !info)
+				{
+					throw std::runtime_error("Could not resolve " + address);
+				}
+				std::memcpy(&result.storage, info->ai_addr, info->ai_addrlen);
+				result.length = static_cast<socklen_t>(info->ai_addrlen);
+				freeaddrinfo(info);
+				return result;
+			}
+
+			Handle open(const Address& address, int type)
+			{
+				startup();
+				auto family = address.local ? AF_UNIX : AF_INET;
+				auto handle = static_cast<Handle>(::socket(family, type, 0));
+#ifdef _WIN32
+				if (static_cast<SOCKET>(handle) == INVALID_SOCKET)
+#else
+				if (handle < 0)
+#endif
+				{
+					throw std::runtime_error("Could not create socket!");
+				}
+				return handle;
+			}
+
+#ifdef _WIN32
+			SOCKET native(Handle socket)
+			{
+				return static_cast<SOCKET>(socket);
+			}
+#else
+			int native(Handle socket)
+			{
+				return static_cast<int>(socket);
+			}
+#endif
+
+			//Unix socket files created by listen, removed again when their listener is closed
+			std::mutex socketPathsMutex;
+			std::map<Handle, std::string> socketPaths;
+
+			bool isSocketFile(const std::string& path, bool& exists)
+			{
+#ifdef _WIN32
+				//AF_UNIX socket files are reparse points on Windows
+				auto attributes = GetFileAttributesA(path.c_str());
+				exists = attributes != INVALID_FILE_ATTRIBUTES;
+				return exists && (attributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+#else
+				struct stat info;
+				exists = ::lstat(path.c_str(), &info) == 0;
+				return exists && S_ISSOCK(info.st_mode);
+#endif
+			}
+
+			void removeFile(const std::string& path)
+			{
+#ifdef _WIN32
+				DeleteFileA(path.c_str());
+#else
+				::unlink(path.c_str());
+#endif
+			}
+
+			//Only a socket nobody is listening on any more may be replaced; anything else is left alone
+			void removeStaleSocket(const Address& address, const std::string& name)
+			{
+				bool exists;
+				bool socket = isSocketFile(address.path, exists);
+				if (!exists)
+				{
+					return;
+				}
+				if (!socket)
+				{
+					throw std::runtime_error("Could not listen on " + name + ": " + address.path + " exists and is not a socket");
+				}
+
+				auto probe = open(address, SOCK_STREAM);
+				bool live = ::connect(native(probe), reinterpret_cast<const sockaddr*>(&address.storage), address.length) == 0;
+#ifdef _WIN32
+				::closesocket(native(probe));
+#else
+				::close(native(probe));
+#endif
+				if (live)
+				{
+					throw std::runtime_error("Could not listen on " + name + ": another process is already listening there");
+				}
+				removeFile(address.path);
+			}
+		}
+
+		Handle listen(const std::string& address)
+		{
+			auto resolved = resolve(address, SOCK_STREAM);
+			if (resolved.local)
+			{
+				removeStaleSocket(resolved, address);
+			}
+			auto handle = open(resolved, SOCK_STREAM);
+
+			if (!resolved.local)
+			{
+				int reuse = 1;
+				setsockopt(native(handle), SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+			}
+
+			if (::bind(native(handle), reinterpret_cast<const sockaddr*>(&resolved.storage), resolved.length) != 0
+				|| ::listen(native(handle), 8) != 0)
+			{
+				close(handle);
+				throw std::runtime_error("Could not listen on " + address);
+			}
+
+			if (resolved.local)
+			{
+				std::lock_guard<std::mutex> lock(socketPathsMutex);
+				socketPaths[handle] = resolved.path;
+			}
+			return handle;
+		}
+
+		Handle connect(const std::string& address)
+		{
+			auto resolved = resolve(address, SOCK_STREAM);
+			auto handle = open(resolved, SOCK_STREAM);
+			if (::connect(native(handle), reinterpret_cast<const sockaddr*>(&resolved.storage), resolved.length) != 0)
+			{
+				close(handle);
+				throw std::runtime_error("Could not connect to " + address);
+			}
+			return handle;
+		}
+
+		Handle accept(Handle listener, int timeoutMs)
+		{
+			if (!waitReadable(listener, timeoutMs))
+			{
+				return InvalidHandle;
+			}
+
+			auto client = static_cast<Handle>(::accept(native(listener), nullptr, nullptr));
+#ifdef _WIN32
+			if (static_cast<SOCKET>(client) == INVALID_SOCKET)
+#else
+			if (client < 0)
+#endif
+			{
+				return InvalidHandle;
+			}
+
+			//Small, latency-sensitive messages; harmless (and ignored) on Unix sockets
+			int noDelay = 1;
+			setsockopt(native(client), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+			return client;
+		}
+
+		Handle bindUdp(const std::string& address)
+		{
+			auto resolved = resolve(address, SOCK_DGRAM);
+			auto handle = open(resolved, SOCK_DGRAM);
+			if (::bind(native(handle), reinterpret_cast<const sockaddr*>(&resolved.storage), resolved.length) != 0)
+			{
+				close(handle);
+				throw std::runtime_error("Could not bind " + address);
+			}
+			return handle;
+		}
+
+		Endpoint resolveUdp(const std::string& address)
+		{
+			static_assert(sizeof(sockaddr_storage) <= sizeof(Endpoint::storage), "Endpoint too small for a socket address");
+			auto resolved = resolve(address, SOCK_DGRAM);
+			Endpoint endpoint;
+			std::memcpy(endpoint.storage, &resolved.storage, sizeof(resolved.storage));
+			endpoint.length = static_cast<int>(resolved.length);
+			return endpoint;
+		}
+
+		bool sendTo(Handle socket, const Endpoint& endpoint, const void* data, size_t size)
+		{
+			auto sent = ::sendto(native(socket), static_cast<const char*>(data), static_cast<int>(size), 0,
+				reinterpret_cast<const sockaddr*>(endpoint.storage), static_cast<socklen_t>(endpoint.length));
+			return sent == static_cast<decltype(sent)>(size);
+		}
+
+		long receiveFrom(Handle socket, void* data, size_t size, int timeoutMs)
+		{
+			if (!waitReadable(socket, timeoutMs))
+			{
+				return -1;
+			}
+			auto received = ::recvfrom(native(socket), static_cast<char*>(data), static_cast<int>(size), 0, nullptr, nullptr);
+			return static_cast<long>(received);
+		}
+
+		unsigned short localPort(Handle socket)
+		{
+			sockaddr_in address;
+			socklen_t length = sizeof(address);
+			if (::getsockname(native(socket), reinterpret_cast<sockaddr*>(&address), &length) != 0)
+			{
+				return 0;
+			}
+			return ntohs(address.sin_port);
+		}
+
+		bool waitReadable(Handle socket, int timeoutMs)
+		{
+#ifdef _WIN32
+			WSAPOLLFD entry;
+			entry.fd = native(socket);
+			entry.events = POLLRDNORM;
+			entry.revents = 0;
+			return WSAPoll(&entry, 1, timeoutMs) > 0;
+#else
+			pollfd entry;
+			entry.fd = native(socket);
+			entry.events = POLLIN;
+			entry.revents = 0;
+			return ::poll(&entry, 1, timeoutMs) > 0;
+#endif
+		}
+
+		bool sendAll(Handle socket, const void* data, size_t size)
+		{
+			auto bytes = static_cast<const char*>(data);
+			while (size > 0)
+			{
+#ifdef _WIN32
+				auto sent = ::send(native(socket), bytes, static_cast<int>(size), 0);
+#else
+				auto sent = ::send(native(socket), bytes, size, MSG_NOSIGNAL);
+#endif
+				if (sent <= 0)
+				{
+					return false;
+				}
+				bytes += sent;
+				size -= static_cast<size_t>(sent);
+			}
+			return true;
+		}
+
+		long sendSome(Handle socket, const void* data, size_t size)
+		{
+#ifdef _WIN32
+			auto sent = ::send(native(socket), static_cast<const char*>(data), static_cast<int>(size), 0);
+			if (sent < 0 && WSAGetLastError() == WSAEWOULDBLOCK)
+			{
+				return 0;
+			}
+#else
+			auto sent = ::send(native(socket), data, size, MSG_NOSIGNAL);
+			if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			{
+				return 0;
+			}
+#endif
+			return static_cast<long>(sent);
+		}
+
+		long receive(Handle socket, void* data, size_t size)
+		{
+			return static_cast<long>(::recv(native(socket), static_cast<char*>(data), static_cast<int>(size), 0));
+		}
+
+		void setNonBlocking(Handle socket)
+		{
+#ifdef _WIN32
+			u_long enabled = 1;
+			ioctlsocket(native(socket), FIONBIO, &enabled);
+#else
+			::fcntl(native(socket), F_SETFL, ::fcntl(native(socket), F_GETFL, 0) | O_NONBLOCK);
+#endif
+		}
+
+		void close(Handle socket)
+		{
+			if (socket == InvalidHandle)
+			{
+				return;
+			}
+#ifdef _WIN32
+			::closesocket(native(socket));
+#else
+			::close(native(socket));
+#endif
+
+			std::string path;
+			{
+				std::lock_guard<std::mutex> lock(socketPathsMutex);
+				auto found = socketPaths.find(socket);
+				if (found == socketPaths.end())
+				{
+					return;
+				}
+				path = found->second;
+				socketPaths.erase(found);
+			}
+			removeFile(path);
+		}
+	};
+};
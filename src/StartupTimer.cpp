@@ -0,0 +1,52 @@
+//Per-phase startup timing, from process start to the first emulated frame, plus warm-up after it
+
+#include "StartupTimer.h"
+#include <iomanip>
+#include <sstream>
+
+namespace Chip8 {
+	StartupTimer::StartupTimer() :
+		_firstFrame(),
+		_firstFramePhases(0),
+		_last(std::chrono::steady_clock::now()),
+		_start(_last)
+	{
+		_phases.reserve(8);
+	}
+
+	void StartupTimer::mark(const char* phase)
+	{
+		auto now = std::chrono::steady_clock::now();
+		_phases.push_back(Phase{ phase, now - _last });
+		_last = now;
+	}
+
+	void StartupTimer::firstFrame()
+	{
+		mark("first frame");
+		_firstFrame = _last;
+		_firstFramePhases = _phases.size();
+	}
+
+	std::string StartupTimer::report() const
+	{
+		auto ms = [](std::chrono::steady_clock::duration duration)
+		{
+			return std::chrono::duration<double, std::milli>(duration).count();
+		};
+
+		std::ostringstream out;
+		out << std::fixed << std::setprecision(2) << "Startup: " << ms(total()) << "ms to first frame (";
+		auto firstFramePhases = _firstFramePhases > 0 ? _firstFramePhases : _phases.size();
+		for (size_t i = 0; i < firstFramePhases; i++)
+		{
+			out << (i == 0 ? "" : ", ") << _phases[i].name << " " << ms(_phases[i].duration) << "ms";
+		}
+		out << ")";
+		for (size_t i = firstFramePhases; i < _phases.size(); i++)
+		{
+			out << (i == firstFramePhases ? ", then " : ", ") << _phases[i].name << " " << ms(_phases[i].duration) << "ms";
+		}
+		return out.str();
+	}
+};
@@ -0,0 +1,250 @@
+//Framebuffer stream for local viewers, with key input coming back.
+
+#include "StreamServer.h"
+#include <algorithm>
+
+namespace Chip8 {
+	namespace {
+		const size_t RowBytes = 64 / 8;
+		const size_t Rows = 32;
+
+		void putLength(std::string& message, size_t at, size_t length)
+		{
+			message[at] = static_cast<char>(length & 0xFF);
+			message[at + 1] = static_cast<char>(length >> 8);
+		}
+
+		std::shared_ptr<const std::string> helloMessage()
+		{
+			static const auto hello = std::make_shared<const std::string>(std::string("H\x07\x00" "C8FS\x01\x40\x20", 10));
+			return hello;
+		}
+	};
+
+	StreamServer::StreamServer(const std::string& address) :
+		_bytesEncoded(0),
+		_frame(0),
+		_listener(Net::listen(address)),
+		_previous(),
+		_started(false)
+	{
+	}
+
+	StreamServer::~StreamServer()
+	{
+		for (auto& viewer : _viewers)
+		{
+			Net::close(viewer.socket);
+		}
+		Net::close(_listener);
+	}
+
+	unsigned short StreamServer::keyMask() const
+	{
+		unsigned short mask = 0;
+		for (auto& viewer : _viewers)
+		{
+			mask |= viewer.keys;
+		}
+		return mask;
+	}
+
+	void StreamServer::acceptViewers()
+	{
+		Net::Handle socket;
+		while ((socket = Net::accept(_listener, 0)) != Net::InvalidHandle)
+		{
+			Net::setNonBlocking(socket);
+
+			Viewer viewer;
+			viewer.socket = socket;
+			viewer.keys = 0;
+			viewer.queuedBytes = 0;
+			viewer.sentOfFront = 0;
+			viewer.needsKeyframe = true;
+			enqueue(viewer, helloMessage());
+			_viewers.push_back(std::move(viewer));
+		}
+	}
+
+	StreamServer::Message StreamServer::encode(const std::array<unsigned char, Machine::PackedFramebufferSize>& packed, bool keyframe) const
+	{
+		auto message = std::make_shared<std::string>();
+		message->reserve(3 + 5 + Rows * (2 + 65));
+		message->push_back('F');
+		message->append(2, '\0');
+		for (int i = 0; i < 4; i++)
+		{
+			message->push_back(static_cast<char>(_frame >> (8 * i)));
+		}
+		auto rowCountAt = message->size();
+		message->push_back('\0');
+
+		unsigned char rows = 0;
+		for (size_t row = 0; row < Rows; row++)
+		{
+			auto bytes = &packed[row * RowBytes];
+			if (!keyframe && std::equal(bytes, bytes + RowBytes, &_previous[row * RowBytes]))
+			{
+				continue;
+			}
+			rows++;
+
+			message->push_back(static_cast<char>(row));
+			auto runCountAt = message->size();
+			message->push_back('\0');
+
+			//Alternating unlit/lit runs, so a blank row is a single byte
+			unsigned char runs = 0;
+			unsigned char length = 0;
+			unsigned char lit = 0;
+			for (size_t x = 0; x < 64; x++)
+			{
+				unsigned char pixel = (bytes[x / 8] >> (7 - x % 8)) & 1;
+				if (pixel != lit)
+				{
+					message->push_back(static_cast<char>(length));
+					runs++;
+					length = 0;
+					lit = pixel;
+				}
+				length++;
+			}
+			message->push_back(static_cast<char>(length));
+			runs++;
+			(*message)[runCountAt] = static_cast<char>(runs);
+		}
+
+		(*message)[rowCountAt] = static_cast<char>(rows);
+		putLength(*message, 1, message->size() - 3);
+		return message;
+	}
+
+	void StreamServer::enqueue(Viewer& viewer, const Message& message)
+	{
+		if (viewer.queuedBytes + message->size() > MaxQueuedBytes)
+		{
+			//Too far behind: drop whatever hasn't started going out, and resync with a keyframe once it catches up
+			while (viewer.queue.size() > (viewer.sentOfFront > 0 ? 1u : 0u))
+			{
+				viewer.queuedBytes -= viewer.queue.back()->size();
+				viewer.queue.pop_back();
+			}
+			viewer.needsKeyframe = true;
+			return;
+		}
+
+		viewer.queue.push_back(message);
+		viewer.queuedBytes += message->size();
+	}
+
+	bool StreamServer::flush(Viewer& viewer)
+	{
+		while (!viewer.queue.empty())
+		{
+			auto& front = *viewer.queue.front();
+			auto sent = Net::sendSome(viewer.socket, front.data() + viewer.sentOfFront, front.size() - viewer.sentOfFront);
+			if (sent < 0)
+			{
+				return false;
+			}
+			if (sent == 0)
+			{
+				break;
+			}
+
+			viewer.sentOfFront += static_cast<size_t>(sent);
+			viewer.queuedBytes -= static_cast<size_t>(sent);
+			if (viewer.sentOfFront == front.size())
+			{
+				viewer.queue.pop_front();
+				viewer.sentOfFront = 0;
+			}
+		}
+		return true;
+	}
+
+	bool StreamServer::readInput(Viewer& viewer)
+	{
+		char buffer[256];
+		while (Net::waitReadable(viewer.socket, 0))
+		{
+			auto received = Net::receive(viewer.socket, buffer, sizeof(buffer));
+			if (received <= 0)
+			{
+				return false;
+			}
+			viewer.input.append(buffer, static_cast<size_t>(received));
+		}
+
+		while (viewer.input.size() >= 3)
+		{
+			size_t length = static_cast<unsigned char>(viewer.input[1]) | static_cast<unsigned char>(viewer.input[2]) << 8;
+			if (length > 1024)
+			{
+				return false;
+			}
+			if (viewer.input.size() < 3 + length)
+			{
+				break;
+			}
+
+			if (viewer.input[0] == 'K' && length >= 2)
+			{
+				viewer.keys = static_cast<unsigned short>(static_cast<unsigned char>(viewer.input[3]) |
+					static_cast<unsigned char>(viewer.input[4]) << 8);
+			}
+			viewer.input.erase(0, 3 + length);
+		}
+		return true;
+	}
+
+	void StreamServer::update(const Machine& machine)
+	{
+		acceptViewers();
+
+		std::array<unsigned char, Machine::PackedFramebufferSize> packed;
+		machine.packFramebuffer(packed.data());
+		bool changed = !_started || packed != _previous;
+
+		//Encoded at most once each per frame, however many viewers there are
+		Message delta;
+		Message keyframe;
+		for (auto& viewer : _viewers)
+		{
+			if (viewer.needsKeyframe)
+			{
+				if (!keyframe)
+				{
+					keyframe = encode(packed, true);
+					_bytesEncoded += keyframe->size();
+				}
+				viewer.needsKeyframe = false;
+				enqueue(viewer, keyframe);
+			}
+			else if (changed)
+			{
+				if (!delta)
+				{
+					delta = encode(packed, false);
+					_bytesEncoded += delta->size();
+				}
+				enqueue(viewer, delta);
+			}
+		}
+		_previous = packed;
+		_started = true;
+		_frame++;
+
+		for (size_t i = 0; i < _viewers.size();)
+		{
+			if (readInput(_viewers[i]) && flush(_viewers[i]))
+			{
+				i++;
+				continue;
+			}
+			Net::close(_viewers[i].socket);
+			_viewers.erase(_viewers.begin() + static_cast<long>(i));
+		}
+	}
+};
@@ -0,0 +1,144 @@
+//Chrome/Perfetto trace-event recorder for the frame pipeline.
+
+#include "Tracer.h"
+#include <atomic>
+#include <iomanip>
+#include <stdexcept>
+
+namespace Chip8 {
+	Tracer::Span::Span(Tracer* tracer, const char* name) :
+		_name(name),
+		_start(tracer ? Clock::now() : Clock::time_point()),
+		_tracer(tracer)
+	{
+	}
+
+	Tracer::Span::~Span()
+	{
+		if (_tracer)
+		{
+			_tracer->complete(_name, _start, Clock::now());
+		}
+	}
+
+	Tracer::Tracer(const std::string& fileName) :
+		_file(fileName),
+		_first(true),
+		_origin(Clock::now()),
+		_stopping(false)
+	{
+		if (!_file)
+		{
+			throw std::runtime_error("Could not open trace output file!");
+		}
+
+		//JSON array format; viewers accept it even if the closing bracket never gets written
+		_file << "[\n";
+		_pending.reserve(FlushThreshold);
+		_writing.reserve(FlushThreshold);
+		_writer = std::thread(&Tracer::writeLoop, this);
+	}
+
+	Tracer::~Tracer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+		_wake.notify_one();
+		_writer.join();
+
+		_file << "\n]\n";
+	}
+
+	long long Tracer::since(Clock::time_point time) const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(time - _origin).count();
+	}
+
+	unsigned int Tracer::threadNumber()
+	{
+		static std::atomic<unsigned int> next(1);
+		thread_local unsigned int number = next++;
+		return number;
+	}
+
+	void Tracer::push(const Event& event)
+	{
+		bool full = false;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_pending.push_back(event);
+			full = _pending.size() >= FlushThreshold;
+		}
+		if (full)
+		{
+			_wake.notify_one();
+		}
+	}
+
+	void Tracer::complete(const char* name, Clock::time_point start, Clock::time_point end)
+	{
+		push(Event{ name, 'X', since(start), since(end) - since(start), 0, threadNumber() });
+	}
+
+	void Tracer::counter(const char* name, long long value)
+	{
+		push(Event{ name, 'C', since(Clock::now()), 0, value, threadNumber() });
+	}
+
+	void Tracer::instant(const char* name)
+	{
+		push(Event{ name, 'i', since(Clock::now()), 0, 0, threadNumber() });
+	}
+
+	void Tracer::writeLoop()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (true)
+		{
+			//Wake when a buffer fills, or every so often so the file stays reasonably current
+			_wake.wait_for(lock, std::chrono::milliseconds(250), [this] { return _stopping || _pending.size() >= FlushThreshold; });
+
+			_writing.swap(_pending);
+			bool stopping = _stopping;
+
+			lock.unlock();
+			writeEvents(_writing);
+			_writing.clear();
+			lock.lock();
+
+			if (stopping && _pending.empty())
+			{
+				break;
+			}
+		}
+	}
+
+	void Tracer::writeEvents(const std::vector<Event>& events)
+	{
+		for (auto& event : events)
+		{
+			_file << (_first ? "" : ",\n");
+			_first = false;
+
+			//Trace-event timestamps are microseconds
+			_file << "{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase << "\",\"pid\":1,\"tid\":" << event.thread
+				<< std::fixed << std::setprecision(3) << ",\"ts\":" << event.timestamp / 1000.0;
+
+			switch (event.phase)
+			{
+			case 'X':
+				_file << ",\"dur\":" << event.duration / 1000.0 << "}";
+				break;
+			case 'C':
+				_file << ",\"args\":{\"value\":" << event.value << "}}";
+				break;
+			default:
+				_file << ",\"s\":\"t\"}";
+				break;
+			}
+		}
+		_file.flush();
+	}
+};
@@ -0,0 +1,27 @@
+//Unreliable, unordered datagram transport between two netplay peers.
+
+#include "Transport.h"
+
+namespace Chip8 {
+	UdpTransport::UdpTransport(const std::string& localAddress, const std::string& remoteAddress) :
+		_remote(Net::resolveUdp(remoteAddress)),
+		_socket(Net::bindUdp(localAddress))
+	{
+	}
+
+	UdpTransport::~UdpTransport()
+	{
+		Net::close(_socket);
+	}
+
+	void UdpTransport::send(const void* data, size_t size)
+	{
+		//A lost datagram is no different from one dropped on the way
+		Net::sendTo(_socket, _remote, data, size);
+	}
+
+	long UdpTransport::receive(void* data, size_t size)
+	{
+		return Net::receiveFrom(_socket, data, size, 0);
+	}
+};
@@ -0,0 +1,161 @@
+//C ABI for the batched CHIP-8 environment
+
+#include "chip8_env.h"
+#include "Environment.h"
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+struct chip8_env
+{
+	std::unique_ptr<Chip8::Environment> environment;
+	//Kept so a done condition can be added after the score reward, in either order
+	std::unique_ptr<Chip8::MemoryScoreReward> score;
+};
+
+namespace {
+	thread_local std::string lastError;
+
+	template<typename Function>
+	int guarded(Function function)
+	{
+		try
+		{
+			function();
+			return 0;
+		}
+		catch (const std::exception& e)
+		{
+			lastError = e.what();
+			return -1;
+		}
+	}
+
+	void applyScore(chip8_env* env)
+	{
+		env->environment->setRewardExtractor(env->score->clone());
+	}
+}
+
+extern "C" {
+
+chip8_env* chip8_env_create(const unsigned char* rom, size_t rom_size, unsigned int batch_size, unsigned int frame_skip,
+	unsigned int seed)
+{
+	try
+	{
+		auto env = std::make_unique<chip8_env>();
+		env->environment = std::make_unique<Chip8::Environment>(rom, rom_size, batch_size, frame_skip, seed);
+		return env.release();
+	}
+	catch (const std::exception& e)
+	{
+		lastError = e.what();
+		return nullptr;
+	}
+}
+
+void chip8_env_destroy(chip8_env* env)
+{
+	delete env;
+}
+
+unsigned int chip8_env_batch_size(const chip8_env* env)
+{
+	return static_cast<unsigned int>(env->environment->batchSize());
+}
+
+size_t chip8_env_observation_size(void)
+{
+	return Chip8::Environment::observationSize();
+}
+
+int chip8_env_set_score_reward(chip8_env* env, unsigned short address, unsigned short length, int bcd)
+{
+	return guarded([&]
+	{
+		env->score = std::make_unique<Chip8::MemoryScoreReward>(address, length, bcd != 0);
+		applyScore(env);
+	});
+}
+
+int chip8_env_set_done_condition(chip8_env* env, unsigned short address, unsigned char value)
+{
+	return guarded([&]
+	{
+		if (!env->score)
+		{
+			throw std::logic_error("Set a score reward before its done condition!");
+		}
+		env->score->setDoneCondition(address, value);
+		applyScore(env);
+	});
+}
+
+int chip8_env_set_reward_callback(chip8_env* env, chip8_reward_fn fn, void* user)
+{
+	return guarded([&]
+	{
+		env->score.reset();
+		//The batch lives in one vector that is never resized, so a machine's index is its offset from the first
+		const chip8_env* self = env;
+		auto batch = &env->environment->machine(0);
+		env->environment->setRewardExtractor(std::make_unique<Chip8::CallbackReward>(
+			[self, fn, user, batch](const Chip8::Machine& machine, bool& done)
+			{
+				unsigned char finished = 0;
+				auto index = static_cast<unsigned int>(&machine - batch);
+				float reward = fn(self, index, &finished, user);
+				done = done || finished != 0;
+				return reward;
+			}));
+	});
+}
+
+int chip8_env_set_max_episode_frames(chip8_env* env, unsigned long long frames)
+{
+	return guarded([&] { env->environment->setMaxEpisodeFrames(frames); });
+}
+
+int chip8_env_reset(chip8_env* env, unsigned char* observations)
+{
+	return guarded([&] { env->environment->reset(observations); });
+}
+
+int chip8_env_step(chip8_env* env, const unsigned short* actions, unsigned char* observations, float* rewards,
+	unsigned char* dones)
+{
+	return guarded([&] { env->environment->step(actions, observations, rewards, dones); });
+}
+
+int chip8_env_peek(const chip8_env* env, unsigned int index, unsigned short address, unsigned char* value)
+{
+	return guarded([&]
+	{
+		if (address >= Chip8::Memory::Size)
+		{
+			throw std::out_of_range("Address outside guest memory!");
+		}
+		*value = env->environment->machine(index).peek(address);
+	});
+}
+
+int chip8_env_register(const chip8_env* env, unsigned int index, unsigned char reg, unsigned char* value)
+{
+	return guarded([&]
+	{
+		if (reg > 0xF)
+		{
+			throw std::out_of_range("No such register!");
+		}
+		*value = env->environment->machine(index).registerValue(reg);
+	});
+}
+
+const char* chip8_env_last_error(void)
+{
+	return lastError.c_str();
+}
+
+}
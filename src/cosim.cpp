@@ -0,0 +1,207 @@
+//Co-simulation runner: plays a ROM on the reference interpreter and a candidate engine in lockstep
+//and reports the first instruction where they disagree.
+//
+//Key log format, one "<frame> <hex mask>" per line ('#' starts a comment): the mask is held from that frame on.
+
+#include "CoSimulator.h"
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+	const unsigned int CyclesPerFrame = 540 / 60;
+
+	void printUsage()
+	{
+		std::cout << "Usage: Chip8CoSim [options] <rom>" << std::endl << std::endl;
+		std::cout << "  --engine <name>     Candidate engine: idle-skip (default), core or reference" << std::endl;
+		std::cout << "  --frames <n>        Frames to run (default 3600)" << std::endl;
+		std::cout << "  --interval <n>      Instructions between state comparisons (default 1000)" << std::endl;
+		std::cout << "  --keys <file>       Key log to replay" << std::endl;
+		std::cout << "  --random-keys <s>   Change to a random key mask every 1-60 frames, seeded with s" << std::endl;
+	}
+
+	//Whole-string unsigned parse; stoull alone accepts "12zz" and throws on "zz"
+	bool parseNumber(const std::string& text, int base, unsigned long long& value)
+	{
+		if (text.empty() || text[0] == '-' || text[0] == '+')
+		{
+			return false;
+		}
+		try
+		{
+			size_t used = 0;
+			value = std::stoull(text, &used, base);
+			return used == text.size();
+		}
+		catch (const std::logic_error&)
+		{
+			return false;
+		}
+	}
+
+	int badNumber(const std::string& option, const std::string& value)
+	{
+		std::cerr << option << ": expected a number, got \"" << value << "\"" << std::endl;
+		return 2;
+	}
+
+	bool loadKeys(const std::string& path, Chip8::CoSimulator& simulator)
+	{
+		std::ifstream file(path);
+		if (!file)
+		{
+			std::cerr << "Could not open key log " << path << std::endl;
+			return false;
+		}
+
+		std::string line;
+		for (size_t number = 1; std::getline(file, line); number++)
+		{
+			std::istringstream words(line.substr(0, line.find('#')));
+			std::string frameText, maskText, extra;
+			if (!(words >> frameText))
+			{
+				continue;
+			}
+
+			unsigned long long frame, mask;
+			if (!(words >> maskText) || words >> extra || !parseNumber(frameText, 10, frame)
+				|| !parseNumber(maskText, 16, mask) || mask > 0xFFFF)
+			{
+				std::cerr << path << ":" << number << ": expected <frame> <hex mask>" << std::endl;
+				return false;
+			}
+			simulator.setKeys(frame, static_cast<unsigned short>(mask));
+		}
+		return true;
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	std::string engineName = "idle-skip";
+	unsigned long long frames = 3600;
+	unsigned int interval = 1000;
+	std::string keysPath;
+	bool randomKeys = false;
+	unsigned int seed = 0;
+	std::string romPath;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		unsigned long long value = 0;
+		if (arg == "--engine" && hasValue)
+		{
+			engineName = argv[++i];
+		}
+		else if (arg == "--frames" && hasValue)
+		{
+			if (!parseNumber(argv[++i], 10, value))
+			{
+				return badNumber(arg, argv[i]);
+			}
+			frames = value;
+		}
+		else if (arg == "--interval" && hasValue)
+		{
+			if (!parseNumber(argv[++i], 10, value) || value > 0xFFFFFFFFull)
+			{
+				return badNumber(arg, argv[i]);
+			}
+			interval = static_cast<unsigned int>(value);
+		}
+		else if (arg == "--keys" && hasValue)
+		{
+			keysPath = argv[++i];
+		}
+		else if (arg == "--random-keys" && hasValue)
+		{
+			if (!parseNumber(argv[++i], 10, value) || value > 0xFFFFFFFFull)
+			{
+				return badNumber(arg, argv[i]);
+			}
+			randomKeys = true;
+			seed = static_cast<unsigned int>(value);
+		}
+		else if (arg.rfind("--", 0) == 0 || !romPath.empty())
+		{
+			printUsage();
+			return 2;
+		}
+		else
+		{
+			romPath = arg;
+		}
+	}
+
+	std::unique_ptr<Chip8::Engine> candidate;
+	if (engineName == "idle-skip")
+	{
+		candidate = std::make_unique<Chip8::IdleSkipEngine>();
+	}
+	else if (engineName == "core")
+	{
+		candidate = std::make_unique<Chip8::CoreEngine>();
+	}
+	else if (engineName == "reference")
+	{
+		candidate = std::make_unique<Chip8::ReferenceEngine>();
+	}
+	if (romPath.empty() || !candidate)
+	{
+		printUsage();
+		return 2;
+	}
+
+	Chip8::Machine machine;
+	try
+	{
+		machine.loadProgram(romPath);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 2;
+	}
+
+	Chip8::ReferenceEngine reference;
+	Chip8::CoSimulator simulator(reference, *candidate, interval, CyclesPerFrame);
+	if (!keysPath.empty() && !loadKeys(keysPath, simulator))
+	{
+		return 2;
+	}
+	if (randomKeys)
+	{
+		//xorshift32, as in the machine's own RNG
+		auto state = seed == 0 ? 1u : seed;
+		auto next = [&]
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		};
+		for (unsigned long long frame = 0; frame < frames; frame += 1 + next() % 60)
+		{
+			//Mostly a single key or none, like a player would
+			auto roll = next();
+			simulator.setKeys(frame, roll % 4 == 0 ? 0 : static_cast<unsigned short>(1u << (roll >> 8) % 16));
+		}
+	}
+
+	Chip8::Divergence divergence;
+	if (!simulator.run(machine, frames * CyclesPerFrame, divergence))
+	{
+		std::cout << divergence.report(reference, *candidate);
+		return 1;
+	}
+
+	std::cout << engineName << " matches reference over " << frames << " frames (" << frames * CyclesPerFrame
+		<< " instructions, " << simulator.checks() << " checks)" << std::endl;
+	return 0;
+}
@@ -0,0 +1,68 @@
+//Debugger checks run by ctest: watchpoints on guest accesses that wrap past 0xFFF.
+//Exits 1 and names the first failed check.
+
+#include "Debugger.h"
+#include <iostream>
+
+namespace {
+	int failures = 0;
+
+	void expect(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::cerr << "FAILED: " << what << std::endl;
+			failures++;
+		}
+	}
+
+	//Fx55 through the top of memory, then the wrapped bytes run as an Fx55 fetched at 0xFFF
+	//  200 60F1 6155           V0 = F1, V1 = 55
+	//  204 AFFF F155           FFF = F1, 000 = 55
+	//  208 A300 1FFF           I = 300, run F1 55 from FFF/000: 300 = F1, 301 = 55
+	const unsigned char WrappedStore[] = {
+		0x60, 0xF1, 0x61, 0x55,
+		0xAF, 0xFF, 0xF1, 0x55,
+		0xA3, 0x00, 0x1F, 0xFF
+	};
+
+	void wrappedStoreHitsWatch()
+	{
+		Chip8::Machine machine;
+		machine.loadProgram(WrappedStore, sizeof(WrappedStore));
+		Chip8::Debugger debugger(machine);
+
+		expect(debugger.setWatchpoint(0x000, 1, Chip8::Debugger::WatchWrite), "watch 000");
+		auto stop = debugger.run(100);
+		expect(stop.reason == Chip8::StopReason::WriteWatch, "Fx55 at FFF reports a write to 000");
+		expect(stop.address == 0x000, "write watch address is 000");
+		expect(machine.programCounter() == 0x208, "stopped after the wrapped Fx55");
+		expect(machine.peek(0x000) == 0x55, "wrapped byte written");
+	}
+
+	void fetchAtTopDecodes()
+	{
+		Chip8::Machine machine;
+		machine.loadProgram(WrappedStore, sizeof(WrappedStore));
+		Chip8::Debugger debugger(machine);
+
+		expect(debugger.setWatchpoint(0x301, 1, Chip8::Debugger::WatchWrite), "watch 301");
+		auto stop = debugger.run(100);
+		expect(stop.reason == Chip8::StopReason::WriteWatch, "opcode fetched across FFF/000 is decoded");
+		expect(stop.address == 0x301, "write watch address is 301");
+		expect(machine.peek(0x301) == 0x55, "wrapped opcode ran");
+	}
+};
+
+int main()
+{
+	wrappedStoreHitsWatch();
+	fetchAtTopDecodes();
+
+	if (failures != 0)
+	{
+		return 1;
+	}
+	std::cout << "debugger: all checks passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,125 @@
+//libFuzzer target: arbitrary ROMs and key schedules through the bounds-checked headless core.
+//
+//Input layout: one byte n (mod 17) for the schedule length, then n entries of
+//[frames, key mask low, key mask high], then the ROM. Each entry holds its keys for 1-16 frames;
+//entries with the top bit of frames set run cycle by cycle without idle skipping instead.
+//
+//A guest fault aborts with its description, so libFuzzer keeps a reproducer. Set
+//CHIP8_FUZZ_FAULTS=ignore to treat faults as a normal end of the run and let the sanitizers
+//hunt for accesses the checks don't cover.
+
+#include "Machine.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+	const unsigned int CyclesPerFrame = 540 / 60;
+	const unsigned long long TailFrames = 60;
+	bool ignoreFaults = false;
+
+	void runInput(const uint8_t* data, size_t size)
+	{
+		size_t steps = data[0] % 17;
+		size_t scheduleSize = 1 + steps * 3;
+		if (size < scheduleSize)
+		{
+			return;
+		}
+
+		size_t romSize = size - scheduleSize;
+		if (romSize >= 4096 - 512)
+		{
+			romSize = 4096 - 512 - 1;
+		}
+
+		Chip8::Machine machine;
+		machine.loadProgram(data + scheduleSize, romSize);
+
+		for (size_t i = 0; i < steps; i++)
+		{
+			auto entry = data + 1 + i * 3;
+			unsigned int frames = (entry[0] & 0x0F) + 1u;
+			machine.setKeyMask(static_cast<unsigned short>(entry[1] | (entry[2] << 8)));
+
+			if ((entry[0] & 0x80) != 0)
+			{
+				for (unsigned int frame = 0; frame < frames; frame++)
+				{
+					machine.runCycles(CyclesPerFrame, false);
+					machine.cycleTimers();
+				}
+			}
+			else
+			{
+				machine.runFrames(frames, CyclesPerFrame);
+			}
+
+			//Exercise the copy-on-write paths too
+			if ((entry[0] & 0x40) != 0)
+			{
+				machine = machine.fork();
+			}
+		}
+
+		machine.setKeyMask(0);
+		machine.runFrames(TailFrames, CyclesPerFrame);
+	}
+};
+
+extern "C" int LLVMFuzzerInitialize(int*, char***)
+{
+	auto mode = std::getenv("CHIP8_FUZZ_FAULTS");
+	ignoreFaults = mode && std::strcmp(mode, "ignore") == 0;
+	return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	if (size == 0)
+	{
+		return 0;
+	}
+
+	try
+	{
+		runInput(data, size);
+	}
+	catch (const Chip8::MachineFault& fault)
+	{
+		if (!ignoreFaults)
+		{
+			std::fprintf(stderr, "Guest fault: %s\n", fault.what());
+			std::abort();
+		}
+	}
+	return 0;
+}
+
+#ifdef CHIP8_FUZZ_STANDALONE
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+//Replays inputs without libFuzzer (for compilers without -fsanitize=fuzzer, or to check a crash)
+int main(int argc, char* argv[])
+{
+	LLVMFuzzerInitialize(&argc, &argv);
+
+	unsigned long long runs = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 1; i < argc; i++)
+	{
+		std::ifstream file(argv[i], std::ios::binary);
+		std::vector<uint8_t> input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		LLVMFuzzerTestOneInput(input.data(), input.size());
+		runs++;
+	}
+	auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::printf("Ran %llu inputs in %.3fs\n", runs, elapsed);
+	return 0;
+}
+#endif
@@ -2,48 +2,564 @@
 //Based off of the CHIP-8 tutorial from multigesture.net
 
 #include "../build/_deps/novelrt-src/include/NovelRT.h"
+#include "AllocationCounter.h"
 #include "CPU.h"
+#include "DebugServer.h"
+#include "FrameCapture.h"
+#include "FramePacer.h"
+#include "LatencyTracker.h"
+#include "Metrics.h"
+#include "MosaicPresenter.h"
+#include "Netplay.h"
+#include "StartupTimer.h"
+#include "StreamServer.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <utility>
+#include <vector>
 
-int main(int argc, char* argv[])
+//Setting CPU to cycle at 540MHz, @ 60fps
+const int cyclesPerUpdate = 540 / 60;
+
+struct Options
+{
+	std::string capturePath;
+	unsigned int captureScale = 1;
+	bool checkAllocations = false;
+	std::string debugAddress;
+	std::string fileName;
+	unsigned long long headlessFrames = 0;
+	unsigned short injectMask = 0;
+	unsigned int injectPeriod = 30;
+	std::string labelPath;
+	bool latency = false;
+	bool logInstructions = false;
+	unsigned int maxSleepMs = 1000 / 60;
+	std::string metricsAddress;
+	unsigned int mosaicCount = 0;
+	std::vector<std::string> mosaicRoms;
+	std::string netplayLocal;
+	std::string netplayRemote;
+	unsigned int netplayRollback = 8;
+	bool pacing = false;
+	std::string profilePath;
+	std::string streamAddress;
+	std::string tracePath;
+	unsigned int turboFrames = 0;
+};
+
+void printUsage()
 {
+	std::cout << "NovelCHIP-8! by capnkenny" << std::endl;
+	std::cout << "CHIP-8 Emulator Demo made with NovelRT" << std::endl << std::endl;
+	std::cout << "Usage: chip8.exe [options] [Path to ROM]" << std::endl << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "  --profile <file>   Write guest subroutine profile as collapsed stacks on exit" << std::endl;
+	std::cout << "  --labels <file>    Symbol names for the profile (\"<hex address> <name>\" per line)" << std::endl;
+	std::cout << "  --trace <file>     Write a Chrome trace-event timeline of the frame pipeline on exit" << std::endl;
+	std::cout << "  --metrics <addr>   Serve live Prometheus metrics on unix:<path> or <host>:<port>" << std::endl;
+	std::cout << "  --debug <addr>     Accept a GDB-remote-style debugger on unix:<path> or <host>:<port>" << std::endl;
+	std::cout << "  --stream <addr>    Stream the screen to viewers on unix:<path> or <host>:<port>, taking their keys" << std::endl;
+	std::cout << "  --capture <file>   Record presented frames to a .y4m video or a numbered .png sequence" << std::endl;
+	std::cout << "  --capture-scale <n> Enlarge captured pixels to n x n (default 1)" << std::endl;
+	std::cout << "  --headless <n>     Run n frames without a window, as fast as possible, then exit" << std::endl;
+	std::cout << "  --mosaic <k>       Run k machines tiled in one window; extra ROMs are cycled, Tab moves focus" << std::endl;
+	std::cout << "  --turbo <n>        Emulate n frames per displayed frame" << std::endl;
+	std::cout << "  --latency          Report input-to-photon latency on exit" << std::endl;
+	std::cout << "  --inject <mask>[:<frames>] Headless: toggle these keys (hex mask) every n frames (default 30)" << std::endl;
+	std::cout << "  --netplay <local>@<remote> Two-player rollback netplay over UDP, e.g. 0.0.0.0:7000@192.168.1.5:7000" << std::endl;
+	std::cout << "  --rollback <n>     Netplay: frames to run ahead of the peer before waiting (default 8)" << std::endl;
+	std::cout << "  --check-allocations Report heap allocations after the first frame and exit 1 if any" << std::endl;
+	std::cout << "  --log-instructions Log every executed instruction at debug level" << std::endl;
+	std::cout << "  --pacing           Skip frame work while the ROM is idle and the screen is static" << std::endl;
+	std::cout << "                     (sleeps at most a frame at a time, so the host still wakes every frame)" << std::endl;
+	std::cout << "  --max-sleep <ms>   Longest idle sleep before input is polled again (default and upper bound: one frame)" << std::endl;
+	std::cout << std::endl;
+}
+
+Options parseArguments(int argc, char* argv[])
+{
+	Options options;
+	bool injectGiven = false;
+	bool romGiven = false;
 
 #ifdef _DEBUG
 	//Use this for debugging the emulator
-	std::string fileName = "C:\\roms\\PONG";
-	argc += argc;
+	options.fileName = "C:\\roms\\PONG";
 	std::cout << argv[0] << std::endl;
 #else
-	if (argc > 2)
+	if (argc == 1)
+	{
+		printUsage();
+		exit(1);
+	}
+	else if (argc < 1)
+	{
+		std::cerr << "Need ROM argument to launch properly. Quitting..." << std::endl;
+		exit(-1);
+	}
+#endif
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = (i + 1) < argc;
+
+		if (arg == "--profile" && hasValue)
+		{
+			options.profilePath = argv[++i];
+		}
+		else if (arg == "--labels" && hasValue)
+		{
+			options.labelPath = argv[++i];
+		}
+		else if (arg == "--trace" && hasValue)
+		{
+			options.tracePath = argv[++i];
+		}
+		else if (arg == "--metrics" && hasValue)
+		{
+			options.metricsAddress = argv[++i];
+		}
+		else if (arg == "--debug" && hasValue)
+		{
+			options.debugAddress = argv[++i];
+		}
+		else if (arg == "--stream" && hasValue)
+		{
+			options.streamAddress = argv[++i];
+		}
+		else if (arg == "--capture" && hasValue)
+		{
+			options.capturePath = argv[++i];
+		}
+		else if (arg == "--capture-scale" && hasValue)
+		{
+			options.captureScale = static_cast<unsigned int>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--headless" && hasValue)
+		{
+			options.headlessFrames = std::stoull(argv[++i]);
+		}
+		else if (arg == "--latency")
+		{
+			options.latency = true;
+		}
+		else if (arg == "--inject" && hasValue)
+		{
+			std::string value = argv[++i];
+			auto colon = value.find(':');
+			options.injectMask = static_cast<unsigned short>(std::stoul(value.substr(0, colon), nullptr, 16));
+			if (colon != std::string::npos)
+			{
+				options.injectPeriod = static_cast<unsigned int>(std::stoul(value.substr(colon + 1)));
+			}
+			if (options.injectPeriod == 0)
+			{
+				std::cerr << "--inject needs a period of at least 1 frame! Quitting..." << std::endl;
+				exit(2);
+			}
+			options.latency = true;
+			injectGiven = true;
+		}
+		else if (arg == "--netplay" && hasValue)
+		{
+			std::string value = argv[++i];
+			auto at = value.find('@');
+			if (at == std::string::npos)
+			{
+				std::cerr << "--netplay needs <local>@<remote>! Quitting..." << std::endl;
+				exit(2);
+			}
+			options.netplayLocal = value.substr(0, at);
+			options.netplayRemote = value.substr(at + 1);
+		}
+		else if (arg == "--rollback" && hasValue)
+		{
+			options.netplayRollback = static_cast<unsigned int>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--mosaic" && hasValue)
+		{
+			options.mosaicCount = static_cast<unsigned int>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--turbo" && hasValue)
+		{
+			options.turboFrames = static_cast<unsigned int>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--check-allocations")
+		{
+			options.checkAllocations = true;
+		}
+		else if (arg == "--log-instructions")
+		{
+			options.logInstructions = true;
+		}
+		else if (arg == "--pacing")
+		{
+			options.pacing = true;
+		}
+		else if (arg == "--max-sleep" && hasValue)
+		{
+			options.maxSleepMs = static_cast<unsigned int>(std::stoul(argv[++i]));
+		}
+		else if (arg.rfind("--", 0) == 0)
+		{
+			std::cerr << "Unknown or incomplete option " << arg << "! Quitting..." << std::endl;
+			exit(2);
+		}
+		else if (!romGiven)
+		{
+			options.fileName = arg;
+			romGiven = true;
+		}
+		else
+		{
+			options.mosaicRoms.push_back(arg);
+		}
+	}
+
+	if (!options.mosaicRoms.empty() && options.mosaicCount == 0)
 	{
 		std::cerr << "Too many arguments! Quitting..." << std::endl;
 		exit(2);
 	}
-	else if (argc == 1)
+
+	//The mosaic loop only runs the tiled machines; it has none of the single-machine services
+	if (options.mosaicCount > 0)
 	{
-		std::cout << "NovelCHIP-8! by capnkenny" << std::endl;
-		std::cout << "CHIP-8 Emulator Demo made with NovelRT" << std::endl << std::endl;
-		std::cout << "Usage: chip8.exe [Path to ROM]" << std::endl << std::endl;
-		exit(1);
+		std::vector<std::pair<bool, const char*>> unsupported = {
+			{ options.headlessFrames > 0, "--headless" },
+			{ !options.profilePath.empty(), "--profile" },
+			{ !options.tracePath.empty(), "--trace" },
+			{ !options.metricsAddress.empty(), "--metrics" },
+			{ !options.debugAddress.empty(), "--debug" },
+			{ !options.streamAddress.empty(), "--stream" },
+			{ !options.capturePath.empty(), "--capture" },
+			{ options.latency, "--latency" },
+			{ !options.netplayLocal.empty(), "--netplay" },
+			{ options.checkAllocations, "--check-allocations" },
+			{ options.logInstructions, "--log-instructions" },
+			{ options.pacing, "--pacing" }
+		};
+		for (auto& option : unsupported)
+		{
+			if (option.first)
+			{
+				std::cerr << "--mosaic cannot be combined with " << option.second << "! Quitting..." << std::endl;
+				exit(2);
+			}
+		}
 	}
-	else if (argc < 1)
+
+	if (injectGiven && options.headlessFrames == 0)
+	{
+		std::cerr << "--inject only applies to --headless! Quitting..." << std::endl;
+		exit(2);
+	}
+
+	if (!options.labelPath.empty() && options.profilePath.empty())
+	{
+		std::cerr << "--labels only applies to --profile! Quitting..." << std::endl;
+		exit(2);
+	}
+
+#ifndef _DEBUG
+	if (!romGiven)
 	{
 		std::cerr << "Need ROM argument to launch properly. Quitting..." << std::endl;
 		exit(-1);
 	}
-	
-	std::string fileName = argv[1];
 #endif
-	//Setting CPU to cycle at 540MHz, @ 60fps
-	int cyclesPerUpdate = 540 / 60;
+
+	return options;
+}
+
+std::unique_ptr<Chip8::Profiler> createProfiler(const Options& options)
+{
+	std::unique_ptr<Chip8::Profiler> profiler;
+	if (!options.profilePath.empty())
+	{
+		profiler = std::make_unique<Chip8::Profiler>();
+		if (!options.labelPath.empty())
+		{
+			try
+			{
+				profiler->loadLabels(options.labelPath);
+			}
+			catch (const std::runtime_error& e)
+			{
+				std::cerr << e.what() << " Quitting..." << std::endl;
+				exit(2);
+			}
+		}
+	}
+	return profiler;
+}
+
+//Runs the ROM with no window, audio or input, skipping idle loops
+int runHeadless(const Options& options)
+{
+	Chip8::Machine machine;
+	machine.loadProgram(options.fileName);
+
+	auto profiler = createProfiler(options);
+	machine.setProfiler(profiler.get());
+
+	std::unique_ptr<Chip8::FrameCapture> capture;
+	if (!options.capturePath.empty())
+	{
+		capture = std::make_unique<Chip8::FrameCapture>(options.capturePath, options.captureScale);
+	}
+
+	std::unique_ptr<Chip8::LatencyTracker> latency;
+	std::unique_ptr<Chip8::InputInjector> injector;
+	if (options.latency)
+	{
+		latency = std::make_unique<Chip8::LatencyTracker>();
+		machine.setLatencyTracker(latency.get());
+	}
+	if (options.injectMask != 0)
+	{
+		injector = std::make_unique<Chip8::InputInjector>(options.injectMask, options.injectPeriod);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	unsigned int beeps = 0;
+	unsigned long long allocatingFrames = 0;
+	if (capture || latency)
+	{
+		//Every frame is presented at its end
+		unsigned long long frame = 0;
+		while (frame < options.headlessFrames)
+		{
+			unsigned int at = 0;
+			unsigned short keys = 0;
+			if (injector && injector->due(frame, cyclesPerUpdate, at, keys))
+			{
+				//Keys change part way through the frame, like a host sampling them every cycle
+				machine.runCycles(at, true);
+				auto before = machine.keyMask();
+				machine.setKeyMask(keys);
+				latency->keyChanged(before, keys, machine.cycleCount());
+				machine.runCycles(cyclesPerUpdate - at, true);
+				beeps += machine.cycleTimers() ? 1 : 0;
+			}
+			else
+			{
+				beeps += machine.runFrames(1, cyclesPerUpdate);
+			}
+			frame++;
+
+			if (machine.drawFlag)
+			{
+				machine.drawFlag = false;
+				if (latency)
+				{
+					latency->presented(machine.cycleCount());
+				}
+			}
+			if (capture)
+			{
+				capture->submit(machine);
+			}
+
+			//An idle stretch can't change the screen, so it is still skipped in bulk (up to the next injected key)
+			auto idle = std::min(machine.idleFrames(cyclesPerUpdate), options.headlessFrames - frame);
+			if (injector)
+			{
+				idle = std::min<unsigned long long>(idle, options.injectPeriod - 1 - frame % options.injectPeriod);
+			}
+			if (idle > 0)
+			{
+				beeps += machine.runFrames(idle, cyclesPerUpdate);
+				if (capture)
+				{
+					capture->repeat(idle);
+				}
+				frame += idle;
+			}
+		}
+	}
+	else if (options.checkAllocations)
+	{
+		//Frame by frame, so an allocation can be pinned to its frame; the first frame may still warm up
+		std::array<unsigned char, Chip8::Machine::PackedFramebufferSize> presented;
+		for (unsigned long long frame = 0; frame < options.headlessFrames; frame++)
+		{
+			Chip8::AllocationCounter counter;
+			beeps += machine.runFrames(1, cyclesPerUpdate);
+			if (machine.drawFlag)
+			{
+				machine.drawFlag = false;
+				machine.packFramebuffer(presented.data());
+			}
+
+			auto allocations = counter.allocations();
+			if (frame > 0 && allocations > 0)
+			{
+				if (allocatingFrames == 0)
+				{
+					std::cerr << "First steady-state allocation in frame " << frame << " (" << allocations << " allocations)" << std::endl;
+				}
+				allocatingFrames++;
+			}
+		}
+	}
+	else
+	{
+		beeps = machine.runFrames(options.headlessFrames, cyclesPerUpdate);
+	}
+	auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+	std::cout << "Ran " << options.headlessFrames << " frames in " << elapsed.count() << "ms ("
+		<< beeps << " beeps)" << std::endl;
+	if (options.checkAllocations)
+	{
+		std::cout << allocatingFrames << " frames allocated after the first" << std::endl;
+	}
+
+	if (capture)
+	{
+		capture.reset();
+		std::cout << "Frames captured to " << options.capturePath << std::endl;
+	}
+
+	if (latency)
+	{
+		machine.setLatencyTracker(nullptr);
+		std::cout << latency->report(cyclesPerUpdate * 60.0);
+	}
+
+	if (profiler)
+	{
+		machine.setProfiler(nullptr);
+		profiler->writeCollapsed(options.profilePath);
+		std::cout << "Profile written to " << options.profilePath << std::endl;
+	}
+	return allocatingFrames > 0 ? 1 : 0;
+}
+
+//K independent machines tiled in one window, presented as a batch. Only the focused one gets the
+//keyboard and makes sound; Tab moves the focus on.
+int runMosaic(const Options& options, Chip8::StartupTimer& startup)
+{
+	auto runner = NovelRT::NovelRunner(0, "NovelCHIP-8", 60U);
+	auto console = NovelRT::LoggingService(NovelRT::Utilities::Misc::CONSOLE_LOG_APP);
+	//Owned by the runner, which outlives everything here
+	auto input = runner.getInteractionService().lock().get();
+	startup.mark("runner");
+
+	std::vector<std::string> roms(1, options.fileName);
+	roms.insert(roms.end(), options.mosaicRoms.begin(), options.mosaicRoms.end());
+
+	std::vector<std::unique_ptr<Chip8::CPU>> cpus;
+	for (unsigned int i = 0; i < options.mosaicCount; i++)
+	{
+		auto cpu = std::make_unique<Chip8::CPU>(&runner);
+		cpu->loadProgram(roms[i % roms.size()]);
+		//Later copies of a ROM get their own random sequence
+		if (i >= roms.size())
+		{
+			cpu->seed(i + 1);
+		}
+		cpus.push_back(std::move(cpu));
+	}
+	startup.mark("rom");
+
+	auto bkgdTransform = NovelRT::Transform(NovelRT::Maths::GeoVector2<float>(1920 / 2, 1080 / 2), 0, NovelRT::Maths::GeoVector2<float>(1920, 1080));
+	auto bkgd = runner.getRenderer().lock()->createBasicFillRect(bkgdTransform, 3, NovelRT::Graphics::RGBAConfig(0, 0, 0, 255));
+	Chip8::MosaicPresenter presenter(runner.getRenderer(), cpus.size(), 1920.0f, 1080.0f);
+	startup.mark("scene");
+
+	size_t focus = 0;
+	auto framesPerUpdate = options.turboFrames > 0 ? options.turboFrames : 1u;
+	bool firstFrameOut = false;
+	bool prewarmed = false;
+	runner.Update += [&](NovelRT::Timing::Timestamp)
+	{
+		//Off the startup path: the update after the first frame sets up audio for the focused CPU
+		if (firstFrameOut && !prewarmed)
+		{
+			prewarmed = true;
+			startup.mark("first present");
+			cpus[focus]->prepareAudio();
+			startup.mark("prewarm");
+			console.logInfoLine(startup.report());
+		}
+
+		if (input->getKeyState(NovelRT::Input::KeyCode::Tab) == NovelRT::Input::KeyState::KeyDown)
+		{
+			focus = (focus + 1) % cpus.size();
+			presenter.setFocus(focus);
+		}
+
+		for (size_t i = 0; i < cpus.size(); i++)
+		{
+			auto& cpu = *cpus[i];
+			if (i == focus)
+			{
+				cpu.setKeys();
+				cpu.runFrames(framesPerUpdate, cyclesPerUpdate);
+			}
+			else
+			{
+				//Silent: the base machine's runFrames doesn't beep
+				cpu.setKeyMask(0);
+				cpu.Chip8::Machine::runFrames(framesPerUpdate, cyclesPerUpdate);
+			}
+			presenter.update(i, cpu);
+		}
+		presenter.present();
+
+		if (!firstFrameOut)
+		{
+			firstFrameOut = true;
+			startup.firstFrame();
+		}
+	};
+
+	runner.SceneConstructionRequested += [&]
+	{
+		bkgd->executeObjectBehaviour();
+		presenter.draw();
+	};
+
+	runner.runNovel();
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	auto startup = Chip8::StartupTimer();
+	auto options = parseArguments(argc, argv);
+	std::string fileName = options.fileName;
+	startup.mark("arguments");
+
+	if (options.headlessFrames > 0)
+	{
+		return runHeadless(options);
+	}
+	if (options.mosaicCount > 0)
+	{
+		return runMosaic(options, startup);
+	}
 
 	auto runner = NovelRT::NovelRunner(0, "NovelCHIP-8", 60U);
 	auto render = runner.getRenderer();
 	auto input = runner.getInteractionService();
 	auto console = NovelRT::LoggingService(NovelRT::Utilities::Misc::CONSOLE_LOG_APP);
+	startup.mark("runner");
 	
 	console.logInfoLine("Initializing CHIP-8 CPU...");
 	auto cpu = Chip8::CPU(&runner);
+	cpu.setInstructionLogging(options.logInstructions);
+	startup.mark("cpu");
+
+	//Load before building the scene, so a bad ROM fails fast
+	cpu.loadProgram(fileName);
+	startup.mark("rom");
 
 	//Setup gfx and input
 	float screenH = 1080.0f;
@@ -53,102 +569,359 @@ int main(int argc, char* argv[])
 	//Get Pixel and Increment Dimensions
 	auto pixelWidth = screenW / 64;			
 	auto pixelHeight = screenH / 32;
-	auto incrementX = 30.0f;			//X and Y work off of midpoints
-	auto incrementY = 33.75f;
-	
+
 	//Black Background - NovelRT generates blue by default, so we cover it with a black one.
 	auto bkgdTransform = NovelRT::Transform(origin, 0, NovelRT::Maths::GeoVector2<float>(1920, 1080));
 	auto bkgd = runner.getRenderer().lock()->createBasicFillRect(bkgdTransform, 3, NovelRT::Graphics::RGBAConfig(0,0,0,255));
+	startup.mark("scene");
 
 	//Row Major
 	std::array<std::array<std::unique_ptr<NovelRT::Graphics::BasicFillRect>, 64>,32> pixels = 
 		std::array<std::array<std::unique_ptr<NovelRT::Graphics::BasicFillRect>, 64>, 32>();
 
-	//Create pixels in 2D array
-	for (int y = 1; y <= 32; y++)
+	bool pixelsCreated = false;
+
+	//Create pixels in 2D array - on the first draw, or prewarmed once the first frame is out
+	auto ensurePixels = [&]
 	{
-		auto pixelsX = std::array<std::unique_ptr<NovelRT::Graphics::BasicFillRect>, 64>();
-		auto pixelOrigin = NovelRT::Maths::GeoVector2<float>();
-		if (y == 1)
-		{
-			pixelOrigin = NovelRT::Maths::GeoVector2<float>(incrementX / 2, (incrementY / 2));
-		}
-		else
+		if (pixelsCreated)
 		{
-			pixelOrigin = NovelRT::Maths::GeoVector2<float>(incrementX / 2, incrementY);
+			return;
 		}
-		for (int x = 0; x < 64; x++)
+		pixelsCreated = true;
+
+		auto incrementX = 30.0f;			//X and Y work off of midpoints
+		auto incrementY = 33.75f;
+		for (int y = 1; y <= 32; y++)
 		{
-			auto transform = NovelRT::Transform(pixelOrigin, 0, NovelRT::Maths::GeoVector2<float>(pixelWidth, pixelHeight));
-			pixelsX[x] = render.lock()->createBasicFillRect(transform, 2, NovelRT::Graphics::RGBAConfig(255,255,255,0));
-			incrementX += pixelWidth;
-			//Shift the pixels into alignment with the screen
-			if (x != 0)
+			auto pixelsX = std::array<std::unique_ptr<NovelRT::Graphics::BasicFillRect>, 64>();
+			auto pixelOrigin = NovelRT::Maths::GeoVector2<float>();
+			if (y == 1)
+			{
+				pixelOrigin = NovelRT::Maths::GeoVector2<float>(incrementX / 2, (incrementY / 2));
+			}
+			else
 			{
-				pixelsX[x]->transform().position().setX(pixelsX[x]->transform().position().getX() - (pixelWidth / 2));
+				pixelOrigin = NovelRT::Maths::GeoVector2<float>(incrementX / 2, incrementY);
 			}
-			if (y != 1)
+			for (int x = 0; x < 64; x++)
 			{
-				pixelsX[x]->transform().position().setY(pixelsX[x]->transform().position().getY() - (pixelHeight / 2));
+				auto transform = NovelRT::Transform(pixelOrigin, 0, NovelRT::Maths::GeoVector2<float>(pixelWidth, pixelHeight));
+				pixelsX[x] = render.lock()->createBasicFillRect(transform, 2, NovelRT::Graphics::RGBAConfig(255,255,255,0));
+				incrementX += pixelWidth;
+				//Shift the pixels into alignment with the screen
+				if (x != 0)
+				{
+					pixelsX[x]->transform().position().setX(pixelsX[x]->transform().position().getX() - (pixelWidth / 2));
+				}
+				if (y != 1)
+				{
+					pixelsX[x]->transform().position().setY(pixelsX[x]->transform().position().getY() - (pixelHeight / 2));
+				}
+				pixelOrigin.setX(incrementX);
 			}
-			pixelOrigin.setX(incrementX);
+			incrementX = 30.0f;
+			incrementY += pixelHeight;
+			auto point = y - 1;
+			pixels[point] = std::move(pixelsX);
 		}
-		incrementX = 30.0f;
-		incrementY += pixelHeight;
-		auto point = y - 1;
-		pixels[point] = std::move(pixelsX);
+	};
+
+	//Optional guest profiler, written out once the window is closed
+	auto profiler = createProfiler(options);
+	cpu.setProfiler(profiler.get());
+
+	//Optional frame pipeline trace
+	std::unique_ptr<Chip8::Tracer> tracer;
+	if (!options.tracePath.empty())
+	{
+		tracer = std::make_unique<Chip8::Tracer>(options.tracePath);
+		cpu.setTracer(tracer.get());
 	}
 
-	cpu.loadProgram(fileName);
+	//Optional live metrics; the update loop only does relaxed atomic adds
+	std::unique_ptr<Chip8::Metrics> metrics;
+	std::unique_ptr<Chip8::MetricsServer> metricsServer;
+	if (!options.metricsAddress.empty())
+	{
+		metrics = std::make_unique<Chip8::Metrics>();
+		metrics->romHash.store(cpu.romHash(), std::memory_order_relaxed);
+		auto framesPerUpdate = options.turboFrames > 0 ? options.turboFrames : 1u;
+		metrics->clockHz.store(cyclesPerUpdate * 60u * framesPerUpdate, std::memory_order_relaxed);
+		cpu.setMetrics(metrics.get());
+		metricsServer = std::make_unique<Chip8::MetricsServer>(*metrics, options.metricsAddress);
+		console.logInfoLine("Serving metrics on " + options.metricsAddress);
+	}
+
+	//Optional input latency tracking
+	std::unique_ptr<Chip8::LatencyTracker> latency;
+	if (options.latency)
+	{
+		latency = std::make_unique<Chip8::LatencyTracker>(true);
+		cpu.setLatencyTracker(latency.get());
+	}
+
+	//Optional frame capture, encoded on its own thread
+	std::unique_ptr<Chip8::FrameCapture> capture;
+	if (!options.capturePath.empty())
+	{
+		capture = std::make_unique<Chip8::FrameCapture>(options.capturePath, options.captureScale);
+	}
+
+	//Optional debugger stub; the debug engine only runs the guest while a client is attached
+	std::unique_ptr<Chip8::Debugger> debugger;
+	std::unique_ptr<Chip8::DebugServer> debugServer;
+	if (!options.debugAddress.empty())
+	{
+		debugger = std::make_unique<Chip8::Debugger>(cpu);
+		debugServer = std::make_unique<Chip8::DebugServer>(*debugger, options.debugAddress);
+		console.logInfoLine("Waiting for debugger on " + options.debugAddress);
+	}
+
+	//Optional framebuffer stream for remote viewers
+	std::unique_ptr<Chip8::StreamServer> streamServer;
+	if (!options.streamAddress.empty())
+	{
+		streamServer = std::make_unique<Chip8::StreamServer>(options.streamAddress);
+		console.logInfoLine("Streaming on " + options.streamAddress);
+	}
+
+	//Optional rollback netplay; the peer's keys are ORed into ours on the shared keypad
+	std::unique_ptr<Chip8::UdpTransport> transport;
+	std::unique_ptr<Chip8::Netplay> netplay;
+	if (!options.netplayLocal.empty())
+	{
+		transport = std::make_unique<Chip8::UdpTransport>(options.netplayLocal, options.netplayRemote);
+		netplay = std::make_unique<Chip8::Netplay>(cpu, *transport, options.netplayRollback, cyclesPerUpdate);
+		console.logInfoLine("Netplay on " + options.netplayLocal + " with " + options.netplayRemote);
+	}
+
+	auto lastUpdate = std::chrono::steady_clock::now();
+	auto lastCycles = cpu.cycleCount();
+	auto lastDraws = cpu.drawCount();
 	
 	//To prevent unused variable errors, this is used for the delta in the update loop.
 	uint64_t d;
 
+	auto pacer = Chip8::FramePacer(60, std::chrono::milliseconds(options.maxSleepMs));
+	bool firstFrameOut = false;
+	bool prewarmed = false;
+
+	//Following row major as it's 64*32
+	//What each rect currently shows; they are created unlit
+	std::array<unsigned char, 2048> shown = {};
+	auto present = [&]
+	{
+		int pixelRow = 0;
+		int pixelColumn = 0;
+		if (!cpu.drawFlag)
+		{
+			return false;
+		}
+
+		Chip8::Tracer::Span span(tracer.get(), "present");
+		cpu.drawFlag = false;
+		ensurePixels();
+		if (latency)
+		{
+			latency->presented(cpu.cycleCount());
+		}
+		for (int x = 0; x < 2048; x++)
+		{
+			if ((x % 64 == 0) && (x != 0))
+			{
+				pixelRow++;
+			}
+			if (cpu.gfx[x] != shown[x])
+			{
+				shown[x] = cpu.gfx[x];
+				pixels[pixelRow][pixelColumn]->setColourConfig(NovelRT::Graphics::RGBAConfig(255, 255, 255, shown[x] > 0 ? 255 : 0));
+			}
+			pixelColumn++;
+			if (pixelColumn >= 64)
+			{
+				pixelColumn = 0;
+			}
+		}
+		return true;
+	};
+
+	auto setKeys = [&]
+	{
+		Chip8::Tracer::Span span(tracer.get(), "setKeys");
+		auto before = cpu.keyMask();
+		cpu.setKeys();
+		if (streamServer)
+		{
+			cpu.setKeyMask(cpu.keyMask() | streamServer->keyMask());
+		}
+		if (latency)
+		{
+			latency->keyChanged(before, cpu.keyMask(), cpu.cycleCount());
+		}
+	};
+
+	auto runFrames = [&](unsigned long long frames)
+	{
+		Chip8::Tracer::Span span(tracer.get(), "emulateCycle batch");
+		cpu.runFrames(frames, cyclesPerUpdate);
+	};
+
+	unsigned long long allocatingUpdates = 0;
 	runner.Update += [&](NovelRT::Timing::Timestamp delta)
 	{
+		//Off the startup path: the update after the first frame builds what the first beep and the
+		//first draw would otherwise stall on. Done before counting, as it is a one-off.
+		if (firstFrameOut && !prewarmed)
+		{
+			prewarmed = true;
+			startup.mark("first present");
+			cpu.prepareAudio();
+			ensurePixels();
+			startup.mark("prewarm");
+			console.logInfoLine(startup.report());
+		}
+
+		Chip8::AllocationCounter allocationCounter;
+		Chip8::Tracer::Span span(tracer.get(), "Update");
+		unsigned long long cycles = 0;
+		unsigned int draws = 0;
+
 		//Just to get rid of error of unused vars
 		d = delta.getTicks();
-		
-		for (int i = 0; i < cyclesPerUpdate; i++)
+
+		//Debugger attached: the guest runs only while the client has it continued, one frame's worth at a time
+		if (debugServer && debugServer->attached())
+		{
+			Chip8::Tracer::Span debug(tracer.get(), "debugger");
+			auto before = cpu.cycleCount();
+			setKeys();
+			if (debugServer->poll(cyclesPerUpdate))
+			{
+				cpu.cycleTimers();
+			}
+			cycles = cpu.cycleCount() - before;
+			draws += present() ? 1 : 0;
+		}
+		//Netplay: one frame per update in lockstep-with-rollback; a stalled update just presents again
+		else if (netplay)
+		{
+			Chip8::Tracer::Span span(tracer.get(), "netplay");
+			auto before = cpu.cycleCount();
+			setKeys();
+			unsigned int beeps = 0;
+			if (netplay->advance(cpu.keyMask(), beeps) && beeps > 0)
+			{
+				cpu.beep();
+			}
+			cycles = cpu.cycleCount() - before;
+			draws += present() ? 1 : 0;
+		}
+		//Turbo: keys are sampled once, then several emulated frames run (skipping idle loops) before presenting
+		else if (options.turboFrames > 0)
 		{
-			cpu.emulateCycle();
-			cpu.setKeys();
+			setKeys();
+			runFrames(options.turboFrames);
+			cycles = static_cast<unsigned long long>(options.turboFrames) * cyclesPerUpdate;
+			draws += present() ? 1 : 0;
+		}
+		//Adaptive pacing: emulated time follows the wall clock, so after an idle sleep we catch up
+		//with the frames we slept through (skipped analytically, since the guest was idle)
+		else if (options.pacing)
+		{
+			setKeys();
+			auto frames = pacer.framesDue();
+			runFrames(frames);
+			cycles = static_cast<unsigned long long>(frames) * cyclesPerUpdate;
 
-			int pixelRow = 0;
-			int pixelColumn = 0;
-			//Following row major as it's 64*32
-			if (cpu.drawFlag)
+			bool drew = present();
+			draws += drew ? 1 : 0;
+			if (!drew)
 			{
-				cpu.drawFlag = false;
-				for (int x = 0; x < 2048; x++)
+				Chip8::Tracer::Span sleep(tracer.get(), "idle sleep");
+				pacer.sleepIdle(cpu.idleFrames(cyclesPerUpdate));
+			}
+		}
+		else
+		{
+			{
+				Chip8::Tracer::Span batch(tracer.get(), "emulateCycle batch");
+				for (int i = 0; i < cyclesPerUpdate; i++)
 				{
-					if ((x % 64 == 0) && (x != 0))
-					{
-						pixelRow++;
-					}
-					if (cpu.gfx[x] > 0)
-					{
-						pixels[pixelRow][pixelColumn]->setColourConfig(NovelRT::Graphics::RGBAConfig(255, 255, 255, 255));
-					}
-					else
-					{
-						pixels[pixelRow][pixelColumn]->setColourConfig(NovelRT::Graphics::RGBAConfig(255, 255, 255, 0));
-					}
-					pixelColumn++;
-					if (pixelColumn >= 64)
-					{
-						pixelColumn = 0;
-					}
+					cpu.emulateCycle();
+					setKeys();
+					draws += present() ? 1 : 0;
 				}
 			}
-		}
+			cycles = cyclesPerUpdate;
+
 			//Update timers on a 60Hz frequency / 60fps = once per update
+			Chip8::Tracer::Span timers(tracer.get(), "cycleTimers");
 			cpu.cycleTimers();
+		}
+
+		if (capture)
+		{
+			Chip8::Tracer::Span span(tracer.get(), "capture");
+			capture->submit(cpu);
+		}
+
+		if (streamServer)
+		{
+			Chip8::Tracer::Span span(tracer.get(), "stream");
+			streamServer->update(cpu);
+		}
+
+		//Picks up a newly connected debugger, which stops the guest from the next frame on
+		if (debugServer && !debugServer->attached())
+		{
+			debugServer->poll(0);
+		}
+
+		if (tracer)
+		{
+			tracer->counter("cycles per frame", static_cast<long long>(cycles));
+			tracer->counter("draws per frame", draws);
+		}
+
+		if (metrics)
+		{
+			auto now = std::chrono::steady_clock::now();
+			metrics->recordFrameTime(now - lastUpdate);
+			lastUpdate = now;
+
+			Chip8::Metrics::add(metrics->framesPresented, 1);
+			Chip8::Metrics::add(metrics->framebufferUpdates, draws);
+			Chip8::Metrics::add(metrics->instructions, cpu.cycleCount() - lastCycles);
+			Chip8::Metrics::add(metrics->draws, cpu.drawCount() - lastDraws);
+			lastCycles = cpu.cycleCount();
+			lastDraws = cpu.drawCount();
+		}
+
+		//Everything above is steady state once the first frame is out
+		if (options.checkAllocations && firstFrameOut && allocationCounter.allocations() > 0)
+		{
+			if (++allocatingUpdates <= 5)
+			{
+				console.logWarningLine("Update allocated " + std::to_string(allocationCounter.allocations()) + " times");
+			}
+		}
+
+		if (!firstFrameOut)
+		{
+			firstFrameOut = true;
+			startup.firstFrame();
+		}
 	};
 
 	runner.SceneConstructionRequested += [&]
 	{
+		Chip8::Tracer::Span span(tracer.get(), "SceneConstructionRequested");
 		bkgd->executeObjectBehaviour();
+		if (!pixelsCreated)
+		{
+			return;
+		}
 		
 		for (int i = 0; i < pixels.size(); i++)
 		{
@@ -161,4 +934,67 @@ int main(int argc, char* argv[])
 
 	runner.runNovel();
 
+	if (profiler)
+	{
+		cpu.setProfiler(nullptr);
+		profiler->writeCollapsed(options.profilePath);
+		console.logInfoLine("Profile written to " + options.profilePath);
+	}
+
+	if (latency)
+	{
+		cpu.setLatencyTracker(nullptr);
+		console.logInfoLine(latency->report(cyclesPerUpdate * 60.0));
+	}
+
+	if (capture)
+	{
+		auto dropped = capture->dropped();
+		capture.reset();
+		console.logInfoLine("Frames captured to " + options.capturePath +
+			(dropped > 0 ? " (" + std::to_string(dropped) + " dropped)" : std::string()));
+	}
+
+	if (options.checkAllocations)
+	{
+		auto report = std::to_string(allocatingUpdates) + " updates allocated after the first frame";
+		if (allocatingUpdates > 0)
+		{
+			console.logErrorLine(report);
+		}
+		else
+		{
+			console.logInfoLine(report);
+		}
+	}
+
+	if (netplay)
+	{
+		console.logInfoLine("Netplay: " + std::to_string(netplay->frame()) + " frames, " +
+			std::to_string(netplay->rollbacks()) + " rollbacks (" + std::to_string(netplay->resimulatedFrames()) +
+			" frames re-run), " + std::to_string(netplay->stalls()) + " stalled updates" +
+			(netplay->romMismatch() ? ", peer is running a different ROM" : ""));
+	}
+
+	if (debugServer)
+	{
+		debugServer.reset();
+		debugger.reset();
+	}
+
+	if (metrics)
+	{
+		metricsServer.reset();
+		cpu.setMetrics(nullptr);
+	}
+
+	if (tracer)
+	{
+		cpu.setTracer(nullptr);
+		tracer.reset();
+		console.logInfoLine("Trace written to " + options.tracePath);
+	}
+
+	//Same contract as headless runs: any steady-state allocation fails the check
+	return options.checkAllocations && allocatingUpdates > 0 ? 1 : 0;
 }
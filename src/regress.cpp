@@ -0,0 +1,381 @@
+//Golden-frame regression runner: plays a corpus of ROMs headlessly with scripted keys, one ROM per
+//worker thread, and compares framebuffer hashes at scripted frames with the values in the manifest.
+//
+//Manifest format, one directive per line ('#' starts a comment), paths relative to the manifest:
+//  rom <path>                 starts a case
+//  keys <frame> <hex mask>    key mask held from that frame on
+//  check <frame> [<hash>]     framebuffer hash after that many frames; --update fills it in
+//Golden frames for the visual diff live in <manifest>.golden/<rom path>@<frame>.txt, written by --update.
+
+#include "Machine.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+	const unsigned int CyclesPerFrame = 540 / 60;
+
+	struct Event
+	{
+		unsigned long long frame;
+		bool check;
+		unsigned short keys;
+		bool hasExpected;
+		unsigned long long expected;
+		size_t line;
+	};
+
+	struct Check
+	{
+		unsigned long long frame;
+		unsigned long long hash;
+		std::array<unsigned char, Chip8::Machine::PackedFramebufferSize> packed;
+		const Event* event;
+	};
+
+	struct Case
+	{
+		std::string name;
+		std::filesystem::path rom;
+		std::vector<Event> events;
+		std::vector<Check> checks;
+		std::string error;
+	};
+
+	struct Manifest
+	{
+		std::filesystem::path path;
+		std::vector<std::string> lines;
+		std::vector<Case> cases;
+	};
+
+	bool parseManifest(const std::filesystem::path& path, Manifest& manifest)
+	{
+		std::ifstream file(path);
+		if (!file)
+		{
+			std::cerr << "Could not open manifest " << path.string() << std::endl;
+			return false;
+		}
+
+		manifest.path = path;
+		std::string line;
+		while (std::getline(file, line))
+		{
+			manifest.lines.push_back(line);
+			std::istringstream words(line.substr(0, line.find('#')));
+			std::string directive;
+			if (!(words >> directive))
+			{
+				continue;
+			}
+
+			if (directive == "rom")
+			{
+				std::string rom;
+				words >> rom;
+				Case entry;
+				entry.name = rom;
+				entry.rom = path.parent_path() / rom;
+				manifest.cases.push_back(entry);
+				continue;
+			}
+
+			Event event = Event();
+			event.line = manifest.lines.size() - 1;
+			bool valid = !manifest.cases.empty() && static_cast<bool>(words >> event.frame);
+			if (valid && directive == "keys")
+			{
+				unsigned int mask = 0;
+				valid = static_cast<bool>(words >> std::hex >> mask) && mask <= 0xFFFF;
+				event.keys = static_cast<unsigned short>(mask);
+			}
+			else if (valid && directive == "check")
+			{
+				event.check = true;
+				event.hasExpected = static_cast<bool>(words >> std::hex >> event.expected);
+			}
+			else
+			{
+				valid = false;
+			}
+
+			if (!valid)
+			{
+				std::cerr << path.string() << ":" << event.line + 1 << ": bad directive \"" << line << "\"" << std::endl;
+				return false;
+			}
+			manifest.cases.back().events.push_back(event);
+		}
+		return true;
+	}
+
+	void runCase(Case& entry)
+	{
+		//Checks at a frame see the screen before that frame's keys change anything
+		std::stable_sort(entry.events.begin(), entry.events.end(), [](const Event& a, const Event& b)
+		{
+			return a.frame != b.frame ? a.frame < b.frame : a.check && !b.check;
+		});
+
+		Chip8::Machine machine;
+		try
+		{
+			machine.loadProgram(entry.rom.string());
+		}
+		catch (const std::runtime_error& e)
+		{
+			entry.error = e.what();
+			return;
+		}
+
+		unsigned long long frame = 0;
+		for (const auto& event : entry.events)
+		{
+			machine.runFrames(event.frame - frame, CyclesPerFrame);
+			frame = event.frame;
+
+			if (event.check)
+			{
+				Check check;
+				check.frame = frame;
+				check.hash = machine.framebufferHash();
+				machine.packFramebuffer(check.packed.data());
+				check.event = &event;
+				entry.checks.push_back(check);
+			}
+			else
+			{
+				machine.setKeyMask(event.keys);
+			}
+		}
+	}
+
+	bool pixel(const std::array<unsigned char, Chip8::Machine::PackedFramebufferSize>& packed, int x, int y)
+	{
+		return (packed[y * 8 + x / 8] & (0x80 >> (x % 8))) != 0;
+	}
+
+	//Keyed on the ROM path as written in the manifest, so same-named ROMs in different directories
+	//get their own frames; ".." and root parts are renamed to keep the file inside the golden directory
+	std::filesystem::path goldenPath(const Manifest& manifest, const Case& entry, unsigned long long frame)
+	{
+		auto path = manifest.path;
+		path += ".golden";
+		for (const auto& part : std::filesystem::path(entry.name).lexically_normal())
+		{
+			if (part == "..")
+			{
+				path /= "__";
+			}
+			else if (!part.has_root_path() && !part.empty())
+			{
+				path /= part;
+			}
+		}
+		path += "@" + std::to_string(frame) + ".txt";
+		return path;
+	}
+
+	//Rewrites a check line with a new hash, keeping its indentation and any trailing comment
+	std::string updatedCheck(const std::string& line, unsigned long long frame, const std::string& hash)
+	{
+		auto indent = line.find_first_not_of(" \t");
+		auto comment = line.find('#');
+		while (comment != std::string::npos && comment > 0 && (line[comment - 1] == ' ' || line[comment - 1] == '\t'))
+		{
+			comment--;
+		}
+
+		return line.substr(0, indent == std::string::npos ? 0 : indent) + "check " + std::to_string(frame) + " " + hash
+			+ (comment == std::string::npos ? "" : line.substr(comment));
+	}
+
+	void writeGolden(const std::filesystem::path& path, const Check& check)
+	{
+		std::filesystem::create_directories(path.parent_path());
+		std::ofstream file(path);
+		for (int y = 0; y < 32; y++)
+		{
+			for (int x = 0; x < 64; x++)
+			{
+				file << (pixel(check.packed, x, y) ? '#' : '.');
+			}
+			file << "\n";
+		}
+	}
+
+	//'#' lit in both, '+' only lit now, '-' only lit in the golden frame
+	void printDiff(const std::filesystem::path& golden, const Check& check)
+	{
+		std::vector<std::string> rows;
+		std::ifstream file(golden);
+		std::string row;
+		while (std::getline(file, row))
+		{
+			rows.push_back(row);
+		}
+		bool haveGolden = rows.size() == 32;
+		if (!haveGolden)
+		{
+			std::cout << "    (no golden frame at " << golden.string() << ", showing the actual frame)" << std::endl;
+		}
+
+		for (int y = 0; y < 32; y++)
+		{
+			std::string line = "    ";
+			for (int x = 0; x < 64; x++)
+			{
+				bool actual = pixel(check.packed, x, y);
+				bool expected = haveGolden && x < static_cast<int>(rows[y].size()) && rows[y][x] == '#';
+				line += actual && (expected || !haveGolden) ? '#' : actual ? '+' : expected ? '-' : '.';
+			}
+			std::cout << line << std::endl;
+		}
+	}
+
+	void printUsage()
+	{
+		std::cout << "Usage: Chip8Regress [--update] [--jobs n] <manifest>..." << std::endl << std::endl;
+		std::cout << "  --update    Record the current hashes and golden frames instead of checking them" << std::endl;
+		std::cout << "  --jobs <n>  Worker threads (default: one per core)" << std::endl;
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	bool update = false;
+	unsigned int jobs = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<Manifest> manifests;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--update")
+		{
+			update = true;
+		}
+		else if (arg == "--jobs" && i + 1 < argc)
+		{
+			jobs = std::max(1u, static_cast<unsigned int>(std::stoul(argv[++i])));
+		}
+		else if (arg.rfind("--", 0) == 0)
+		{
+			printUsage();
+			return 2;
+		}
+		else
+		{
+			manifests.emplace_back();
+			if (!parseManifest(arg, manifests.back()))
+			{
+				return 2;
+			}
+		}
+	}
+
+	if (manifests.empty())
+	{
+		printUsage();
+		return 2;
+	}
+
+	std::vector<Case*> work;
+	for (auto& manifest : manifests)
+	{
+		for (auto& entry : manifest.cases)
+		{
+			work.push_back(&entry);
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < std::min<size_t>(jobs, work.size()); i++)
+	{
+		workers.emplace_back([&]
+		{
+			for (auto index = next++; index < work.size(); index = next++)
+			{
+				runCase(*work[index]);
+			}
+		});
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+	size_t failed = 0;
+	size_t checks = 0;
+	for (auto& manifest : manifests)
+	{
+		for (const auto& entry : manifest.cases)
+		{
+			if (!entry.error.empty())
+			{
+				std::cout << "ERROR " << entry.name << ": " << entry.error << std::endl;
+				failed++;
+				continue;
+			}
+
+			bool passed = true;
+			for (const auto& check : entry.checks)
+			{
+				checks++;
+				std::ostringstream hash;
+				hash << std::hex << std::setw(16) << std::setfill('0') << check.hash;
+
+				if (update)
+				{
+					auto& line = manifest.lines[check.event->line];
+					line = updatedCheck(line, check.frame, hash.str());
+					writeGolden(goldenPath(manifest, entry, check.frame), check);
+				}
+				else if (!check.event->hasExpected || check.event->expected != check.hash)
+				{
+					std::cout << "FAIL " << entry.name << " at frame " << check.frame << ": got " << hash.str();
+					if (check.event->hasExpected)
+					{
+						std::cout << ", expected " << std::hex << std::setw(16) << std::setfill('0') << check.event->expected << std::dec;
+					}
+					std::cout << std::endl;
+					printDiff(goldenPath(manifest, entry, check.frame), check);
+					passed = false;
+				}
+			}
+
+			if (!passed)
+			{
+				failed++;
+			}
+			else if (!update)
+			{
+				std::cout << "PASS " << entry.name << " (" << entry.checks.size() << " checks)" << std::endl;
+			}
+		}
+
+		if (update)
+		{
+			std::ofstream file(manifest.path);
+			for (const auto& line : manifest.lines)
+			{
+				file << line << "\n";
+			}
+			std::cout << "Updated " << manifest.path.string() << std::endl;
+		}
+	}
+
+	std::cout << work.size() - failed << "/" << work.size() << " ROMs passed, " << checks << " checks, "
+		<< elapsed.count() << "ms on " << workers.size() << " threads" << std::endl;
+	return failed == 0 ? 0 : 1;
+}